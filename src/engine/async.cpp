@@ -0,0 +1,94 @@
+#include "async.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace Engine
+{
+
+static_assert(std::is_trivially_copyable<SearchResult>::value,
+    "snapshots are copied a word at a time");
+static_assert(sizeof(SearchResult) % 4 == 0,
+    "snapshots are copied a word at a time");
+
+AsyncSearch::AsyncSearch(TranspositionTable *tt)
+    : tt(tt), stop(false), finished(true), published(false), sequence(0)
+{
+    for (auto &word : words)
+        word.store(0, std::memory_order_relaxed);
+}
+
+AsyncSearch::~AsyncSearch()
+{
+    Stop();
+    Join();
+}
+
+void AsyncSearch::Start(
+    const thc::ChessRules &position, const SearchLimits &limits, int threads)
+{
+    Stop();
+    Join();
+
+    stop.store(false, std::memory_order_relaxed);
+    published.store(false, std::memory_order_relaxed);
+    finished.store(false, std::memory_order_release);
+    if (tt)
+        tt->NewSearch();
+
+    // the copy is made here, the caller's position can change straight away
+    worker = std::thread([this, position, limits, threads] {
+        ParallelSearch search(position, tt, threads);
+        search.OnIteration([this, &search](const SearchResult &iteration) {
+            SearchResult result = iteration;
+            result.nodes        = search.Nodes();
+            Publish(result);
+        });
+        Publish(search.Run(limits, &stop));
+        finished.store(true, std::memory_order_release);
+    });
+}
+
+void AsyncSearch::Stop() { stop.store(true, std::memory_order_relaxed); }
+
+void AsyncSearch::Join()
+{
+    if (worker.joinable())
+        worker.join();
+}
+
+void AsyncSearch::Publish(const SearchResult &result)
+{
+    uint32_t buffer[SNAPSHOT_WORDS];
+    memcpy(buffer, &result, sizeof(buffer));
+
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < SNAPSHOT_WORDS; i++)
+        words[i].store(buffer[i], std::memory_order_relaxed);
+    sequence.store(seq + 2, std::memory_order_release);
+    published.store(true, std::memory_order_release);
+}
+
+bool AsyncSearch::Snapshot(SearchResult &result) const
+{
+    if (!published.load(std::memory_order_acquire))
+        return false;
+
+    uint32_t buffer[SNAPSHOT_WORDS];
+    uint32_t before, after;
+    do
+    {
+        before = sequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < SNAPSHOT_WORDS; i++)
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1));
+
+    memcpy(&result, buffer, sizeof(buffer));
+    return true;
+}
+
+} // namespace Engine
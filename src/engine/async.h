@@ -0,0 +1,55 @@
+#pragma once
+
+// a search running on its own thread
+//
+// the controlling thread starts and stops searches, the worker publishes
+// the result of each completed iteration. snapshots are read through a
+// sequence lock, so polling never blocks and never waits on the search
+
+#include "smp.h"
+
+#include <atomic>
+#include <thread>
+
+namespace Engine
+{
+
+class AsyncSearch
+{
+  public:
+    explicit AsyncSearch(TranspositionTable *tt);
+
+    // stops any search and waits for the worker to exit
+    ~AsyncSearch();
+
+    // search a copy of position, a running search is stopped first
+    void Start(
+        const thc::ChessRules &position, const SearchLimits &limits, int threads);
+
+    // ask the search to finish, returns without waiting for it
+    void Stop();
+
+    // true once the search has finished, its snapshot is then final
+    bool Finished() const { return finished.load(std::memory_order_acquire); }
+
+    // latest published result, false if nothing has been published yet
+    // safe to call from any thread while the search runs
+    bool Snapshot(SearchResult &result) const;
+
+  private:
+    void Publish(const SearchResult &result);
+    void Join();
+
+    TranspositionTable *tt;
+    std::thread worker;
+    std::atomic<bool> stop;
+    std::atomic<bool> finished;
+    std::atomic<bool> published;
+
+    // odd while the worker is writing words
+    static const size_t SNAPSHOT_WORDS = sizeof(SearchResult) / 4;
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> words[SNAPSHOT_WORDS];
+};
+
+} // namespace Engine
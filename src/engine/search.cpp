@@ -0,0 +1,399 @@
+#include "search.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace Engine
+{
+
+// only used to order moves, so precision doesn't matter
+static int pieceOrderValue(int piece)
+{
+    switch (tolower(piece))
+    {
+    case 'p': return 1;
+    case 'n': return 3;
+    case 'b': return 3;
+    case 'r': return 5;
+    case 'q': return 9;
+    case 'k': return 20;
+    default: return 0;
+    }
+}
+
+static bool isCapture(const thc::Move &m) { return m.capture != ' '; }
+
+// the table is shared between plies, so mate scores are stored as the
+// distance from the node rather than from the root
+static int scoreToTable(int score, int ply)
+{
+    if (score > SCORE_MATE - MAX_PLY)
+        return score + ply;
+    if (score < -SCORE_MATE + MAX_PLY)
+        return score - ply;
+    return score;
+}
+
+static int scoreFromTable(int score, int ply)
+{
+    if (score > SCORE_MATE - MAX_PLY)
+        return score - ply;
+    if (score < -SCORE_MATE + MAX_PLY)
+        return score + ply;
+    return score;
+}
+
+Search::Search(const thc::ChessRules &position, TranspositionTable *tt)
+    : tt(tt), rootPrepared(false), firstDepth(1), stopFlag(nullptr), nodes(0),
+      publishedNodes(0), aborted(false)
+{
+    // copy the whole of ChessRules, not just the position, so the move
+    // history used for repetition draws comes along
+    static_cast<thc::ChessRules &>(*this) = position;
+}
+
+Search::Search(const Search &main, int threadIndex)
+    : tt(main.tt), root(main.root), rootPrepared(main.rootPrepared),
+      firstDepth(1 + (threadIndex & 1)), stopFlag(nullptr), nodes(0),
+      publishedNodes(0), aborted(false)
+{
+    static_cast<thc::ChessEvaluation &>(*this) = main;
+}
+
+void Search::PrepareRoot()
+{
+    // sorting the root moves with the leaf evaluator also does the
+    // Planning() that EvaluateLeaf() relies on
+    GenLegalMoveListSorted(&root);
+    rootPrepared = true;
+}
+
+SearchResult Search::Run(
+    const SearchLimits &searchLimits, const std::atomic<bool> *stop)
+{
+    limits   = searchLimits;
+    stopFlag = stop;
+    start    = std::chrono::steady_clock::now();
+    nodes    = 0;
+    aborted  = false;
+    publishedNodes.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < MAX_PLY; i++)
+    {
+        killers[i][0].Invalid();
+        killers[i][1].Invalid();
+    }
+
+    SearchResult result;
+    result.best.Invalid();
+
+    if (!rootPrepared)
+        PrepareRoot();
+    if (root.count == 0)
+    {
+        result.score = InCheck() ? -SCORE_MATE : 0;
+        return result;
+    }
+    result.best     = root.moves[0];
+    result.pv[0]    = root.moves[0];
+    result.pvLength = 1;
+
+    int maxDepth = MAX_PLY - 1;
+    if (limits.depth > 0 && limits.depth < maxDepth)
+        maxDepth = limits.depth;
+
+    for (int depth = firstDepth; depth <= maxDepth; depth++)
+    {
+        int alpha     = -SCORE_INF;
+        int bestIndex = 0;
+        pvLength[0]   = 0;
+
+        for (int i = 0; i < root.count; i++)
+        {
+            thc::Move &m = root.moves[i];
+            PushMove(m);
+            nodes++;
+            int score;
+            if (i == 0)
+                score = -AlphaBeta(depth - 1, 1, -SCORE_INF, -alpha);
+            else
+            {
+                // null window first, re-search only if it might be better
+                score = -AlphaBeta(depth - 1, 1, -alpha - 1, -alpha);
+                if (score > alpha && !aborted)
+                    score = -AlphaBeta(depth - 1, 1, -SCORE_INF, -alpha);
+            }
+            PopMove(m);
+            if (aborted)
+                break;
+
+            if (score > alpha)
+            {
+                alpha         = score;
+                bestIndex     = i;
+                pvTable[0][0] = m;
+                for (int j = 1; j < pvLength[1]; j++)
+                    pvTable[0][j] = pvTable[1][j];
+                pvLength[0] = pvLength[1] > 1 ? pvLength[1] : 1;
+            }
+        }
+
+        // a partly searched iteration can't be trusted
+        if (aborted)
+            break;
+
+        result.best     = root.moves[bestIndex];
+        result.score    = alpha;
+        result.depth    = depth;
+        result.pvLength = pvLength[0];
+        memcpy(result.pv, pvTable[0], pvLength[0] * sizeof(thc::Move));
+        result.nodes    = nodes;
+        if (tt)
+            tt->Store(Hash64Key(), result.best, alpha, depth, BOUND_EXACT);
+
+        // Nodes() is otherwise only brought up to date every 1024 nodes, too
+        // rarely for the first iterations' reports
+        publishedNodes.store(nodes, std::memory_order_relaxed);
+        if (onIteration)
+            onIteration(result);
+
+        // search the best move first next time
+        std::rotate(
+            root.moves, root.moves + bestIndex, root.moves + bestIndex + 1);
+
+        if (IsMateScore(alpha))
+            break;
+
+        // the next iteration won't finish, don't start it
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        if (limits.timeMs && elapsed.count() * 2 > limits.timeMs)
+            break;
+    }
+
+    publishedNodes.store(nodes, std::memory_order_relaxed);
+    result.nodes = nodes;
+    return result;
+}
+
+int Search::AlphaBeta(int depth, int ply, int alpha, int beta)
+{
+    pvLength[ply] = ply;
+    if (ShouldStop())
+        return 0;
+
+    // count a single repeat as a draw, whoever could avoid it will
+    if (GetRepetitionCount() > 1)
+        return 0;
+
+    bool inCheck = InCheck();
+    if (inCheck)
+        depth++;
+    if (depth <= 0)
+        return Quiesce(ply, alpha, beta);
+    if (ply >= MAX_PLY - 1)
+        return EvaluateStatic();
+
+    uint64_t key = Hash64Key();
+    thc::Move hashMove;
+    hashMove.Invalid();
+    TTEntry entry;
+    if (tt && tt->Probe(key, entry))
+    {
+        hashMove = entry.move;
+
+        // only cut off in null window nodes so the pv stays intact
+        int score = scoreFromTable(entry.score, ply);
+        if (entry.depth >= depth && beta - alpha == 1 &&
+            (entry.bound == BOUND_EXACT ||
+                (entry.bound == BOUND_LOWER && score >= beta) ||
+                (entry.bound == BOUND_UPPER && score <= alpha)))
+            return score;
+    }
+
+    thc::MOVELIST list;
+    GenLegalMoveList(&list);
+    if (list.count == 0)
+        return inCheck ? -SCORE_MATE + ply : 0;
+
+    OrderMoves(list, ply, hashMove);
+
+    int originalAlpha = alpha;
+    thc::Move bestMove;
+    bestMove.Invalid();
+    for (int i = 0; i < list.count; i++)
+    {
+        thc::Move &m = list.moves[i];
+        PushMove(m);
+        nodes++;
+        int score;
+        if (i == 0)
+            score = -AlphaBeta(depth - 1, ply + 1, -beta, -alpha);
+        else
+        {
+            score = -AlphaBeta(depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta && !aborted)
+                score = -AlphaBeta(depth - 1, ply + 1, -beta, -alpha);
+        }
+        PopMove(m);
+        if (aborted)
+            return 0;
+
+        if (score > alpha)
+        {
+            alpha             = score;
+            bestMove          = m;
+            pvTable[ply][ply] = m;
+            for (int j = ply + 1; j < pvLength[ply + 1]; j++)
+                pvTable[ply][j] = pvTable[ply + 1][j];
+            pvLength[ply] =
+                pvLength[ply + 1] > ply + 1 ? pvLength[ply + 1] : ply + 1;
+
+            if (alpha >= beta)
+            {
+                if (!isCapture(m) && m != killers[ply][0])
+                {
+                    killers[ply][1] = killers[ply][0];
+                    killers[ply][0] = m;
+                }
+                if (tt)
+                    tt->Store(key, m, scoreToTable(alpha, ply), depth,
+                        BOUND_LOWER);
+                return alpha;
+            }
+        }
+    }
+
+    if (tt)
+        tt->Store(key, bestMove, scoreToTable(alpha, ply), depth,
+            alpha > originalAlpha ? BOUND_EXACT : BOUND_UPPER);
+    return alpha;
+}
+
+int Search::Quiesce(int ply, int alpha, int beta)
+{
+    pvLength[ply] = ply;
+    if (ShouldStop())
+        return 0;
+
+    int standPat = EvaluateStatic();
+    if (ply >= MAX_PLY - 1 || standPat >= beta)
+        return standPat;
+    if (standPat > alpha)
+        alpha = standPat;
+
+    // only captures and queen promotions, the rest are quiet
+    thc::MOVELIST list;
+    GenLegalMoveList(&list);
+    int count = 0;
+    for (int i = 0; i < list.count; i++)
+    {
+        const thc::Move &m = list.moves[i];
+        if (isCapture(m) || m.special == thc::SPECIAL_PROMOTION_QUEEN)
+            list.moves[count++] = m;
+    }
+    list.count = count;
+
+    thc::Move noMove;
+    noMove.Invalid();
+    OrderMoves(list, ply, noMove);
+
+    for (int i = 0; i < list.count; i++)
+    {
+        thc::Move &m = list.moves[i];
+        PushMove(m);
+        nodes++;
+        int score = -Quiesce(ply + 1, -beta, -alpha);
+        PopMove(m);
+        if (aborted)
+            return 0;
+
+        if (score > alpha)
+        {
+            alpha = score;
+            if (alpha >= beta)
+                return alpha;
+        }
+    }
+    return alpha;
+}
+
+int Search::EvaluateStatic()
+{
+    int material, positional;
+    EvaluateLeaf(material, positional);
+
+    // same weighting as GenLegalMoveListSorted()
+    int score = material * 4 + positional;
+    return white ? score : -score;
+}
+
+bool Search::InCheck()
+{
+    return AttackedPiece((thc::Square)(white ? wking_square : bking_square));
+}
+
+void Search::OrderMoves(thc::MOVELIST &list, int ply, thc::Move hashMove)
+{
+    int scores[MAXMOVES];
+    for (int i = 0; i < list.count; i++)
+    {
+        const thc::Move &m = list.moves[i];
+        int score          = 0;
+        if (hashMove.Valid() && SameMove(m, hashMove))
+            score = 1000000;
+        else if (isCapture(m))
+        {
+            // most valuable victim, least valuable attacker
+            score = 10000 + 100 * pieceOrderValue(m.capture) -
+                    pieceOrderValue(squares[m.src]);
+        }
+        else if (m.special == thc::SPECIAL_PROMOTION_QUEEN)
+            score = 9000;
+        else if (m == killers[ply][0])
+            score = 8000;
+        else if (m == killers[ply][1])
+            score = 7999;
+        scores[i] = score;
+    }
+
+    // insertion sort, lists are short and mostly need little movement
+    for (int i = 1; i < list.count; i++)
+    {
+        thc::Move m = list.moves[i];
+        int score   = scores[i];
+        int j       = i - 1;
+        for (; j >= 0 && scores[j] < score; j--)
+        {
+            list.moves[j + 1] = list.moves[j];
+            scores[j + 1]     = scores[j];
+        }
+        list.moves[j + 1] = m;
+        scores[j + 1]     = score;
+    }
+}
+
+bool Search::ShouldStop()
+{
+    if (aborted)
+        return true;
+
+    if (limits.nodes && nodes >= limits.nodes)
+        aborted = true;
+    else if ((nodes & 1023) == 0)
+    {
+        publishedNodes.store(nodes, std::memory_order_relaxed);
+        if (stopFlag && stopFlag->load(std::memory_order_relaxed))
+            aborted = true;
+        else if (limits.timeMs)
+        {
+            auto elapsed =
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start);
+            aborted = elapsed.count() >= limits.timeMs;
+        }
+    }
+    return aborted;
+}
+
+} // namespace Engine
@@ -0,0 +1,111 @@
+#pragma once
+
+// alpha-beta search on top of thc::ChessEvaluation
+//
+// iterative deepening principal variation search with a quiescence search
+// at the leaves. EvaluateLeaf() scores positions, in units of a tenth of a
+// pawn for material (scaled by 4) plus positional bonuses
+
+#include "../thc/thc.h"
+#include "tt.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace Engine
+{
+
+const int MAX_PLY    = 64;
+const int SCORE_MATE = 1000000;
+const int SCORE_INF  = SCORE_MATE + 1;
+
+// mate scores are SCORE_MATE minus the distance to mate in plies
+inline bool IsMateScore(int score)
+{
+    return score > SCORE_MATE - MAX_PLY || score < -SCORE_MATE + MAX_PLY;
+}
+
+// a zero field means no limit of that kind
+struct SearchLimits
+{
+    uint32_t timeMs = 0;
+    uint64_t nodes  = 0;
+    int depth       = 0;
+};
+
+struct SearchResult
+{
+    thc::Move best;    // Invalid() if there are no legal moves
+    int score = 0;     // from the point of view of the side to move
+    int depth = 0;     // last fully searched depth
+    uint64_t nodes = 0;
+    int pvLength   = 0;
+    thc::Move pv[MAX_PLY];
+};
+
+class Search : public thc::ChessEvaluation
+{
+  public:
+    // keeps the game history of position for repetition checks
+    // tt may be shared with other searches, the owner calls NewSearch() on
+    // it before each search, nullptr searches without one
+    explicit Search(
+        const thc::ChessRules &position, TranspositionTable *tt = nullptr);
+
+    // helper for a parallel search, shares main's table and copies its
+    // planning and root moves so only main ever calls Planning()
+    Search(const Search &main, int threadIndex);
+
+    // sort the root moves, also does the Planning() EvaluateLeaf() needs
+    // Run() calls it if it hasn't been called yet
+    void PrepareRoot();
+
+    // stop can be set from another thread to end the search early
+    SearchResult Run(
+        const SearchLimits &limits, const std::atomic<bool> *stop = nullptr);
+
+    // nodes searched so far, safe to read from other threads while running
+    // (updated every so often, and at the end of each iteration)
+    uint64_t Nodes() const
+    {
+        return publishedNodes.load(std::memory_order_relaxed);
+    }
+
+    // called on the searching thread after each completed iteration
+    std::function<void(const SearchResult &)> onIteration;
+
+  private:
+    int AlphaBeta(int depth, int ply, int alpha, int beta);
+    int Quiesce(int ply, int alpha, int beta);
+
+    // leaf score from the point of view of the side to move
+    int EvaluateStatic();
+
+    bool InCheck();
+
+    // order moves best first, hashMove (if valid) goes to the front
+    void OrderMoves(thc::MOVELIST &list, int ply, thc::Move hashMove);
+
+    // check limits every so often, sets aborted
+    bool ShouldStop();
+
+    TranspositionTable *tt;
+    thc::MOVELIST root;
+    bool rootPrepared;
+    int firstDepth; // helpers skip ahead to spread threads over depths
+
+    SearchLimits limits;
+    const std::atomic<bool> *stopFlag;
+    std::chrono::steady_clock::time_point start;
+    uint64_t nodes;
+    std::atomic<uint64_t> publishedNodes;
+    bool aborted;
+
+    thc::Move killers[MAX_PLY][2];
+    thc::Move pvTable[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+};
+
+} // namespace Engine
@@ -0,0 +1,57 @@
+#include "smp.h"
+
+#include <thread>
+
+namespace Engine
+{
+
+int DefaultThreadCount()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? (int)n : 1;
+}
+
+ParallelSearch::ParallelSearch(
+    const thc::ChessRules &position, TranspositionTable *tt, int threads)
+{
+    if (threads < 1)
+        threads = 1;
+
+    searches.emplace_back(new Search(position, tt));
+    searches[0]->PrepareRoot();
+    for (int i = 1; i < threads; i++)
+        searches.emplace_back(new Search(*searches[0], i));
+}
+
+SearchResult ParallelSearch::Run(
+    const SearchLimits &limits, const std::atomic<bool> *stop)
+{
+    std::atomic<bool> helpersStop(false);
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < searches.size(); i++)
+    {
+        Search *helper = searches[i].get();
+        helpers.emplace_back([helper, &limits, &helpersStop] {
+            helper->Run(limits, &helpersStop);
+        });
+    }
+
+    SearchResult result = searches[0]->Run(limits, stop);
+
+    helpersStop.store(true, std::memory_order_relaxed);
+    for (std::thread &t : helpers)
+        t.join();
+
+    result.nodes = Nodes();
+    return result;
+}
+
+uint64_t ParallelSearch::Nodes() const
+{
+    uint64_t total = 0;
+    for (const auto &search : searches)
+        total += search->Nodes();
+    return total;
+}
+
+} // namespace Engine
@@ -0,0 +1,53 @@
+#pragma once
+
+// lazy SMP, several searches of the same position sharing one table
+//
+// each thread owns a Search (and so its own copy of the position), they
+// only talk through the transposition table. helpers start at alternating
+// depths so they fill the table ahead of the main thread, whose result is
+// the one returned
+
+#include "search.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+
+// a thread per hardware thread, at least one
+int DefaultThreadCount();
+
+class ParallelSearch
+{
+  public:
+    // the root is prepared on the calling thread, threads start in Run()
+    ParallelSearch(
+        const thc::ChessRules &position, TranspositionTable *tt, int threads);
+
+    // limits apply to the main thread, helpers stop when it does
+    // result.nodes is the total over all threads
+    SearchResult Run(
+        const SearchLimits &limits, const std::atomic<bool> *stop = nullptr);
+
+    // called on the main search thread after each completed iteration
+    void OnIteration(std::function<void(const SearchResult &)> callback)
+    {
+        searches[0]->onIteration = std::move(callback);
+    }
+
+    int Threads() const { return (int)searches.size(); }
+
+    // safe to call while Run() is going on another thread
+    uint64_t ThreadNodes(int thread) const
+    {
+        return searches[thread]->Nodes();
+    }
+    uint64_t Nodes() const;
+
+  private:
+    std::vector<std::unique_ptr<Search>> searches; // [0] is the main thread
+};
+
+} // namespace Engine
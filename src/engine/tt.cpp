@@ -0,0 +1,177 @@
+#include "tt.h"
+
+namespace Engine
+{
+
+// data word layout, low bits first
+//  0..15  move, src:6 dst:6 special:4
+//  16..47 score
+//  48..55 depth
+//  56..57 bound
+//  58..63 generation
+static const int GENERATION_BITS = 6;
+static const uint8_t GENERATION_MASK = (1 << GENERATION_BITS) - 1;
+
+static uint64_t pack(thc::Move move, int score, int depth, Bound bound,
+    uint8_t generation)
+{
+    uint64_t m = 0;
+    if (move.Valid())
+        m = (uint64_t)move.src | (uint64_t)move.dst << 6 |
+            (uint64_t)(move.special & 15) << 12;
+    if (depth < 0)
+        depth = 0;
+    else if (depth > 255)
+        depth = 255;
+    return m | (uint64_t)(uint32_t)score << 16 | (uint64_t)depth << 48 |
+           (uint64_t)bound << 56 | (uint64_t)generation << 58;
+}
+
+static thc::Move unpackMove(uint64_t data)
+{
+    thc::Move move;
+    move.Invalid();
+    unsigned m = data & 0xffff;
+    if (m)
+    {
+        move.src     = (thc::Square)(m & 63);
+        move.dst     = (thc::Square)((m >> 6) & 63);
+        move.special = (thc::SPECIAL)(m >> 12);
+        move.capture = ' ';
+    }
+    return move;
+}
+
+static int unpackDepth(uint64_t data) { return (data >> 48) & 0xff; }
+static Bound unpackBound(uint64_t data) { return (Bound)((data >> 56) & 3); }
+static uint8_t unpackGeneration(uint64_t data) { return data >> 58; }
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+    : bucketCount(0), megabytes(0), generation(0)
+{
+    Resize(megabytes);
+}
+
+void TranspositionTable::Resize(size_t mb)
+{
+    if (mb == 0)
+        mb = 1;
+
+    // a power of two number of buckets so the index is just a mask
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= mb * 1024 * 1024)
+        count *= 2;
+
+    if (count != bucketCount)
+    {
+        buckets.reset(new Bucket[count]);
+        bucketCount = count;
+    }
+    megabytes = mb;
+    Clear();
+}
+
+void TranspositionTable::Clear()
+{
+    for (size_t i = 0; i < bucketCount; i++)
+    {
+        for (Entry &e : buckets[i].entries)
+        {
+            e.keyXorData.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation.store(0, std::memory_order_relaxed);
+}
+
+void TranspositionTable::NewSearch()
+{
+    uint8_t next = generation.load(std::memory_order_relaxed) + 1;
+    generation.store(next & GENERATION_MASK, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::Probe(uint64_t key, TTEntry &entry) const
+{
+    Bucket &bucket = BucketFor(key);
+    for (Entry &e : bucket.entries)
+    {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        uint64_t check = e.keyXorData.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || unpackBound(data) == BOUND_NONE)
+            continue;
+
+        entry.move  = unpackMove(data);
+        entry.score = (int32_t)(uint32_t)(data >> 16);
+        entry.depth = unpackDepth(data);
+        entry.bound = unpackBound(data);
+        return true;
+    }
+    return false;
+}
+
+void TranspositionTable::Store(
+    uint64_t key, thc::Move move, int score, int depth, Bound bound)
+{
+    Bucket &bucket = BucketFor(key);
+    Entry *replace = nullptr;
+    int replaceWorth = 0;
+    uint8_t current = generation.load(std::memory_order_relaxed);
+
+    for (Entry &e : bucket.entries)
+    {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        uint64_t check = e.keyXorData.load(std::memory_order_relaxed);
+
+        if ((check ^ data) == key)
+        {
+            // same position, keep a deeper result from this search unless
+            // the new one is exact
+            if (bound != BOUND_EXACT && unpackGeneration(data) == current &&
+                unpackDepth(data) > depth + 2)
+                return;
+
+            // a fail low has no best move, keep the old one
+            if (!move.Valid())
+                move = unpackMove(data);
+            replace = &e;
+            break;
+        }
+
+        // shallow entries and entries from earlier searches go first
+        int age = (current - unpackGeneration(data)) & GENERATION_MASK;
+        int worth = unpackBound(data) == BOUND_NONE
+                        ? -1000
+                        : unpackDepth(data) - 8 * age;
+        if (!replace || worth < replaceWorth)
+        {
+            replace      = &e;
+            replaceWorth = worth;
+        }
+    }
+
+    // two independent stores, a reader that sees one without the other
+    // fails the xor check and treats it as a miss
+    uint64_t data = pack(move, score, depth, bound, current);
+    replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::Hashfull() const
+{
+    size_t samples = bucketCount < 250 ? bucketCount : 250;
+    int used = 0;
+    uint8_t current = generation.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < samples; i++)
+    {
+        for (const Entry &e : buckets[i].entries)
+        {
+            uint64_t data = e.data.load(std::memory_order_relaxed);
+            if (unpackBound(data) != BOUND_NONE &&
+                unpackGeneration(data) == current)
+                used++;
+        }
+    }
+    return (int)(used * 1000 / (samples * BUCKET_ENTRIES));
+}
+
+} // namespace Engine
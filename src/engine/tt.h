@@ -0,0 +1,88 @@
+#pragma once
+
+// transposition table shared between search threads
+//
+// buckets of four entries fill one cache line. each entry is two 64 bit
+// words, the key xor'd with the data and the data itself, written without
+// locks. a reader recomputes key ^ data, so an entry torn by a racing write
+// just looks like a miss
+
+#include "../thc/thc.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Engine
+{
+
+enum Bound : uint8_t
+{
+    BOUND_NONE  = 0,
+    BOUND_UPPER = 1, // score <= stored score (failed low)
+    BOUND_LOWER = 2, // score >= stored score (failed high)
+    BOUND_EXACT = 3,
+};
+
+struct TTEntry
+{
+    thc::Move move; // Invalid() if none stored
+    int score;
+    int depth;
+    Bound bound;
+};
+
+class TranspositionTable
+{
+  public:
+    explicit TranspositionTable(size_t megabytes = 16);
+
+    // reallocates and clears, not safe while a search is running
+    void Resize(size_t megabytes);
+    void Clear();
+
+    // call once at the start of each search so old entries age out
+    void NewSearch();
+
+    bool Probe(uint64_t key, TTEntry &entry) const;
+    void Store(
+        uint64_t key, thc::Move move, int score, int depth, Bound bound);
+
+    // permille of entries written by the current search (sampled)
+    int Hashfull() const;
+
+    size_t SizeMegabytes() const { return megabytes; }
+
+  private:
+    static const int BUCKET_ENTRIES = 4;
+
+    struct Entry
+    {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+
+    struct alignas(64) Bucket
+    {
+        Entry entries[BUCKET_ENTRIES];
+    };
+
+    Bucket &BucketFor(uint64_t key) const
+    {
+        return buckets[key & (bucketCount - 1)];
+    }
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t bucketCount;
+    size_t megabytes;
+    std::atomic<uint8_t> generation; // searches may start on any thread
+};
+
+// the move fields that identify a move, capture is implied by the position
+inline bool SameMove(const thc::Move &a, const thc::Move &b)
+{
+    return a.src == b.src && a.dst == b.dst && a.special == b.special;
+}
+
+} // namespace Engine
@@ -3,13 +3,24 @@
 #include "render/render.h"
 #include "move.h"
 #include "render/render_backend.h"
+#include "render/scheduler.h"
 #include <assert.h>
 #include <stdio.h>
 
+// the computer playing both sides of a board in watch mode
+typedef struct WatchedEngine
+{
+    ChessEngine *engine;
+    bool thinking;
+} WatchedEngine;
+
 struct Game
 {
     Render *render;
     RenderWindow *window;
+    FrameScheduler *scheduler;
+    bool animating; // the next frame differs even without input
+    bool redraw;    // the window must be drawn again, whatever has changed
     Board *boardRender;
     Button *playButton;
     Button *replayButton;
@@ -18,6 +29,18 @@ struct Game
     RenderFont *defaultFont;
 
     ChessBoard *chessBoard;
+    ChessEngine *engine;
+    bool engineThinking; // the engine is searching the current position
+
+    // results of the indexed games reaching the position, NULL without one
+    ChessPositionIndex *positions;
+    uint64_t statsVersion; // of chessBoard when the stats were looked up
+
+    // watch mode, drawn with boardRender's textures
+    BoardGrid *grid;
+    size_t watchCount;
+    ChessBoard **watchBoards;
+    WatchedEngine *watchEngines;
 
     GameState state;
 
@@ -31,7 +54,20 @@ const char *LEGAL_MOVE_TEXTURE = "textures/legal_move.png";
 
 const char *FONT_PATH = "fonts/Nunito-Regular.ttf";
 
-Game *game_init(void)
+// frames are only drawn this often while something moves, idle frames wait
+// for input
+const unsigned TARGET_FPS = 60;
+const bool VSYNC          = true;
+
+// the computer plays the other side, thinking for up to a second a move
+const bool PLAYER_IS_WHITE              = true;
+const ChessSearchBudget COMPUTER_BUDGET = {.time_ms = 1000};
+
+// watched boards move quicker, each searching on a single thread so that
+// they share the cores
+const ChessSearchBudget WATCH_BUDGET = {.time_ms = 200};
+
+Game *game_init(const GameOptions *options)
 {
 
     if (render_init() == RENDER_FAILURE)
@@ -42,6 +78,9 @@ Game *game_init(void)
     assert(g->window);
     g->render = render_create_render(g->window);
     assert(g->render);
+    g->scheduler = create_scheduler(g->render, TARGET_FPS, VSYNC);
+    g->animating = true;
+    g->redraw    = true;
     g->defaultFont = render_create_font(g->render, FONT_PATH, 255);
 
     const BoardColour background = {124, 142, 179, 255};
@@ -106,23 +145,68 @@ Game *game_init(void)
         HOVER_TEXTURE,
         LEGAL_MOVE_TEXTURE,
         FONT_PATH,
-        true);
+        PLAYER_IS_WHITE);
 
     g->state = GAME_STATE_STARTING;
     g->quit  = false;
 
-    g->chessBoard = chess_board_init();
+    g->chessBoard     = chess_board_init();
+    g->engine         = chess_engine_init();
+    g->engineThinking = false;
+
+    g->positions    = NULL;
+    g->statsVersion = 0;
+    if (options->positionIndex)
+    {
+        g->positions = chess_position_index_open(options->positionIndex);
+        if (g->positions == NULL)
+            fprintf(stderr, "can't read %s\n", options->positionIndex);
+    }
+
+    g->grid         = NULL;
+    g->watchCount   = options->watchBoards;
+    g->watchBoards  = NULL;
+    g->watchEngines = NULL;
+    if (g->watchCount > 0)
+    {
+        chess_set_search_threads(1);
+        g->grid = create_board_grid(g->render, g->boardRender, g->watchCount);
+
+        g->watchBoards  = malloc(g->watchCount * sizeof(ChessBoard *));
+        g->watchEngines = malloc(g->watchCount * sizeof(WatchedEngine));
+        for (size_t i = 0; i < g->watchCount; i++)
+        {
+            g->watchBoards[i]           = chess_board_init();
+            g->watchEngines[i].engine   = chess_engine_init();
+            g->watchEngines[i].thinking = false;
+        }
+        g->state = GAME_STATE_WATCHING;
+    }
 
     return g;
 }
 
 void game_destroy(Game *g)
 {
+    for (size_t i = 0; i < g->watchCount; i++)
+    {
+        chess_engine_destroy(g->watchEngines[i].engine);
+        chess_board_destroy(g->watchBoards[i]);
+    }
+    free(g->watchEngines);
+    free(g->watchBoards);
+    if (g->grid)
+        destroy_board_grid(g->grid);
+    if (g->positions)
+        chess_position_index_close(g->positions);
+
+    chess_engine_destroy(g->engine);
     chess_board_destroy(g->chessBoard);
     destroy_board(g->boardRender);
     destroy_button(g->playButton);
     destroy_button(g->replayButton);
     destroy_button(g->exitButton);
+    destroy_scheduler(g->scheduler);
     render_destroy_render(g->render);
     render_destroy_window(g->window);
 
@@ -132,10 +216,61 @@ void game_destroy(Game *g)
     assert(render_is_initialized() == false);
 }
 
+// plays the move of each watched engine that has finished thinking, a game
+// that has ended is replaced by a new one
+static void update_watched_games(Game *g)
+{
+    for (size_t i = 0; i < g->watchCount; i++)
+    {
+        WatchedEngine *w = &g->watchEngines[i];
+        if (chess_board_get_game_end(g->watchBoards[i]) != GAME_NOT_ENDED)
+        {
+            chess_board_destroy(g->watchBoards[i]);
+            g->watchBoards[i] = chess_board_init();
+        }
+
+        ChessSearchInfo info;
+        if (!w->thinking)
+        {
+            chess_engine_start(w->engine, g->watchBoards[i], WATCH_BUDGET);
+            w->thinking = true;
+        }
+        else if (chess_engine_poll(w->engine, &info))
+        {
+            w->thinking = false;
+            chess_board_move(g->watchBoards[i], info.best);
+        }
+    }
+}
+
+// shows under the board how the indexed games reaching its position ended
+static void update_position_stats(Game *g)
+{
+    ChessPositionStats stats;
+    chess_position_index_find(g->positions, g->chessBoard, &stats, NULL, 0);
+
+    char text[128];
+    if (stats.games == 0)
+        snprintf(text, sizeof(text), "No games reached this position");
+    else
+        snprintf(
+            text,
+            sizeof(text),
+            "%u games, white won %u, black won %u, %u drawn",
+            stats.games,
+            stats.white_wins,
+            stats.black_wins,
+            stats.draws);
+    board_set_status(g->render, g->boardRender, text);
+    g->statsVersion = chess_board_version(g->chessBoard);
+}
+
 void game_update(Game *g)
 {
 
-    RenderEvent event = render_poll_events(g->render);
+    RenderEvent event    = scheduler_next_frame(g->scheduler, g->animating);
+    GameState lastState  = g->state;
+    uint64_t lastVersion = chess_board_version(g->chessBoard);
     int w, h;
     switch (event)
     {
@@ -145,30 +280,49 @@ void game_update(Game *g)
         button_set_pos(g->playButton, w / 2, h / 2);
         button_set_pos(g->replayButton, w / 2, h * 2 / 3);
         button_set_pos(g->exitButton, w / 2, h / 3);
-
+        g->redraw = true;
         break;
+    case RENDER_EVENT_WINDOW_EXPOSED: g->redraw = true; break;
     default: break;
     }
 
-    render_clear(g->render);
-
     ChessMoveList moveList; // must declare outside switch
+    moveList.count = 0;
     switch (g->state)
     {
     case GAME_STATE_STARTING:
         if (button_clicked(g->render, g->playButton))
             g->state = GAME_STATE_RUNNING;
         else
-        {
-            button_draw(g->render, g->playButton);
             break;
-        }
     case GAME_STATE_RUNNING:
         chess_board_gen_movelist(g->chessBoard, &moveList);
 
+        // the engine thinks in the background, the board keeps drawing
+        if (chess_board_white_to_play(g->chessBoard) != PLAYER_IS_WHITE &&
+            chess_board_get_game_end(g->chessBoard) == GAME_NOT_ENDED)
+        {
+            ChessSearchInfo info;
+            if (!g->engineThinking)
+            {
+                chess_engine_start(g->engine, g->chessBoard, COMPUTER_BUDGET);
+                g->engineThinking = true;
+            }
+            else if (chess_engine_poll(g->engine, &info))
+            {
+                g->engineThinking = false;
+                chess_board_move(g->chessBoard, info.best);
+                chess_board_gen_movelist(g->chessBoard, &moveList);
+            }
+
+            // the player can't move the computer's pieces
+            if (g->engineThinking)
+                moveList.count = 0;
+        }
+
         board_update(g->render, g->boardRender, event);
 
-        board_draw(g->render, g->boardRender, g->chessBoard, &moveList);
+        board_handle_input(g->render, g->boardRender, g->chessBoard, &moveList);
 
         if (chess_board_get_game_end(g->chessBoard) != GAME_NOT_ENDED)
         {
@@ -179,6 +333,8 @@ void game_update(Game *g)
     case GAME_STATE_ENDED:
         if (button_clicked(g->render, g->replayButton))
         {
+            chess_engine_stop(g->engine);
+            g->engineThinking = false;
             chess_board_destroy(g->chessBoard);
             g->chessBoard = chess_board_init();
             g->state      = GAME_STATE_RUNNING;
@@ -187,16 +343,70 @@ void game_update(Game *g)
         {
             g->quit = true;
         }
-        else
+        break;
+    case GAME_STATE_WATCHING:
+        board_grid_update(g->grid, event);
+        update_watched_games(g);
+        break;
+    }
+
+    // looked up once a move, not every frame
+    if (g->positions && chess_board_version(g->chessBoard) != g->statsVersion)
+        update_position_stats(g);
+
+    // the last frame stays on screen until something in it changes
+    bool dirty = g->redraw || g->state != lastState;
+    switch (g->state)
+    {
+    case GAME_STATE_STARTING:
+        dirty |= button_is_dirty(g->render, g->playButton);
+        break;
+    case GAME_STATE_RUNNING:
+        dirty |= board_is_dirty(
+            g->render, g->boardRender, g->chessBoard, &moveList);
+        break;
+    case GAME_STATE_ENDED:
+        dirty |= button_is_dirty(g->render, g->replayButton) ||
+                 button_is_dirty(g->render, g->exitButton);
+        break;
+    case GAME_STATE_WATCHING:
+        dirty |= board_grid_is_dirty(
+            g->render, g->grid, (const ChessBoard *const *)g->watchBoards);
+        break;
+    }
+
+    if (dirty)
+    {
+        render_clear(g->render);
+        switch (g->state)
         {
+        case GAME_STATE_STARTING:
+            button_draw(g->render, g->playButton);
+            break;
+        case GAME_STATE_RUNNING:
+            board_draw(g->render, g->boardRender, g->chessBoard, &moveList);
+            break;
+        case GAME_STATE_ENDED:
             button_draw(g->render, g->replayButton);
             button_draw(g->render, g->exitButton);
+            break;
+        case GAME_STATE_WATCHING:
+            board_grid_draw(
+                g->render, g->grid, (const ChessBoard *const *)g->watchBoards);
+            break;
         }
-        break;
+        const uint8_t background = 0x0f;
+        render_set_colour(g->render, background, background, background, 0xff);
+        render_submit(g->render);
+        g->redraw = false;
     }
-    const uint8_t background = 0x0f;
-    render_set_colour(g->render, background, background, background, 0xff);
-    render_submit(g->render);
+
+    // a move or a new screen is followed up next frame, e.g. starting the
+    // engine after the player moves, without waiting for more input
+    g->animating = g->engineThinking || board_is_animating(g->boardRender) ||
+                   g->state != lastState ||
+                   chess_board_version(g->chessBoard) != lastVersion ||
+                   g->state == GAME_STATE_WATCHING;
 }
 
 bool game_should_quit(const Game *g) { return g->quit; }
@@ -8,11 +8,22 @@ typedef enum GameState
     GAME_STATE_STARTING, // game is not started yet
     GAME_STATE_RUNNING,  // game is in progress
     GAME_STATE_ENDED,    // game has finished
+    GAME_STATE_WATCHING, // the computer plays itself on a grid of boards
 } GameState;
 
+typedef struct GameOptions
+{
+    // boards the computer plays itself on, 0 to play against it
+    size_t watchBoards;
+
+    // a position index, see src/thc/posindex.h. the results of its games
+    // that reached the position are shown under the board, NULL for none
+    const char *positionIndex;
+} GameOptions;
+
 typedef struct Game Game;
 
-Game *game_init(void);
+Game *game_init(const GameOptions *options);
 
 void game_destroy(Game *);
 
@@ -1,11 +1,33 @@
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "game.h"
 
+// usage:
+//   chess_2.out [options]
+//     --watch <n>            the computer plays itself on n boards at once
+//     --positions <index>    show how the indexed games that reached the
+//                            position ended, see src/thc/posindex.h
+
 int main(int argc, char **argv)
 {
-    Game *g = game_init();
+    GameOptions options = {.watchBoards = 0, .positionIndex = NULL};
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc)
+            options.watchBoards = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--positions") == 0 && i + 1 < argc)
+            options.positionIndex = argv[++i];
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Game *g = game_init(&options);
     while (game_should_quit(g) != true)
         game_update(g);
     game_destroy(g);
@@ -1,11 +1,30 @@
 #include "move.h"
 
+#include <string.h>
+
+// results worked out for a position, reused until the next move
+// the board functions take const boards, so this lives behind a pointer
+typedef struct ChessBoardCache
+{
+    uint64_t version; // bumped by every move
+    uint64_t movelistVersion;
+    ChessMoveList movelist;
+    uint64_t gameEndVersion;
+    ChessGameEnds gameEnd;
+} ChessBoardCache;
+
 struct ChessBoard
 {
     thc_board *thc_b;
+    ChessBoardCache *cache;
     // last move?
 };
 
+struct ChessEngine
+{
+    thc_engine *thc_e;
+};
+
 typedef thc_square ChessSquare;
 typedef thc_move ChessMove;
 
@@ -16,6 +35,12 @@ ChessBoard *chess_board_init()
 {
     ChessBoard *b = malloc(sizeof(ChessBoard));
     b->thc_b      = thc_board_init();
+    b->cache      = malloc(sizeof(ChessBoardCache));
+
+    // versions start at 1 so nothing is cached yet
+    b->cache->version         = 1;
+    b->cache->movelistVersion = 0;
+    b->cache->gameEndVersion  = 0;
     return b;
 }
 
@@ -23,6 +48,7 @@ ChessBoard *chess_board_init()
 void chess_board_destroy(ChessBoard *b)
 {
     thc_board_destroy(b->thc_b);
+    free(b->cache);
     free(b);
 }
 
@@ -30,7 +56,15 @@ void chess_board_destroy(ChessBoard *b)
 // each move contains a src tile and a dst tile
 void chess_board_gen_movelist(const ChessBoard *b, ChessMoveList *list)
 {
-    thc_board_gen_legal_move_list(b->thc_b, list);
+    ChessBoardCache *c = b->cache;
+    if (c->movelistVersion != c->version)
+    {
+        thc_board_gen_legal_move_list(b->thc_b, &c->movelist);
+        c->movelistVersion = c->version;
+    }
+    list->count = c->movelist.count;
+    memcpy(
+        list->moves, c->movelist.moves, c->movelist.count * sizeof(ChessMove));
 }
 
 // make a move
@@ -38,8 +72,11 @@ void chess_board_gen_movelist(const ChessBoard *b, ChessMoveList *list)
 void chess_board_move(const ChessBoard *b, ChessMove m)
 {
     thc_board_play_move(b->thc_b, m);
+    b->cache->version++;
 }
 
+uint64_t chess_board_version(const ChessBoard *b) { return b->cache->version; }
+
 bool chess_board_white_to_play(const ChessBoard *b)
 {
     return thc_board_is_white_move(b->thc_b);
@@ -55,5 +92,89 @@ const char *chess_board_get_squares(const ChessBoard *b)
 
 ChessGameEnds chess_board_get_game_end(const ChessBoard *b)
 {
-    return thc_board_get_game_end(b->thc_b);
+    ChessBoardCache *c = b->cache;
+    if (c->gameEndVersion != c->version)
+    {
+        c->gameEnd        = thc_board_get_game_end(b->thc_b);
+        c->gameEndVersion = c->version;
+    }
+    return c->gameEnd;
+}
+
+ChessMove chess_board_best_move(const ChessBoard *b, ChessSearchBudget budget)
+{
+    return thc_board_best_move(b->thc_b, budget);
+}
+
+void chess_set_hash_size(uint32_t megabytes)
+{
+    thc_set_hash_size(megabytes);
+}
+
+void chess_set_search_threads(int threads)
+{
+    thc_set_search_threads(threads);
+}
+
+ChessEngine *chess_engine_init()
+{
+    ChessEngine *e = malloc(sizeof(ChessEngine));
+    e->thc_e       = thc_engine_init();
+    return e;
+}
+
+void chess_engine_destroy(ChessEngine *e)
+{
+    thc_engine_destroy(e->thc_e);
+    free(e);
+}
+
+void chess_engine_start(
+    ChessEngine *e, const ChessBoard *b, ChessSearchBudget budget)
+{
+    thc_engine_start(e->thc_e, b->thc_b, budget);
+}
+
+void chess_engine_stop(ChessEngine *e) { thc_engine_stop(e->thc_e); }
+
+bool chess_engine_poll(ChessEngine *e, ChessSearchInfo *info)
+{
+    return thc_engine_poll(e->thc_e, info);
+}
+
+ChessArchive *chess_archive_create(const char *path)
+{
+    return thc_archive_create(path);
+}
+
+bool chess_archive_add_move(ChessArchive *a, const ChessBoard *b, ChessMove m)
+{
+    // the index comes from the cached list the player chose the move from
+    ChessMoveList list;
+    chess_board_gen_movelist(b, &list);
+    return thc_archive_add_move(a, &list, m);
+}
+
+bool chess_archive_end_game(ChessArchive *a, const ChessBoard *b)
+{
+    return thc_archive_end_game(a, chess_board_get_game_end(b));
+}
+
+bool chess_archive_close(ChessArchive *a) { return thc_archive_close(a); }
+
+ChessPositionIndex *chess_position_index_open(const char *path)
+{
+    return thc_position_index_open(path);
+}
+
+void chess_position_index_close(ChessPositionIndex *p)
+{
+    thc_position_index_close(p);
+}
+
+size_t chess_position_index_find(
+    ChessPositionIndex *p, const ChessBoard *b, ChessPositionStats *stats,
+    uint64_t *games, size_t max)
+{
+    return thc_position_index_find(p, b->thc_b, stats, games, max);
 }
@@ -11,6 +11,18 @@ typedef thc_movelist ChessMoveList;
 
 typedef thc_game_ends ChessGameEnds;
 
+typedef thc_search_budget ChessSearchBudget;
+
+typedef struct ChessEngine ChessEngine;
+
+typedef thc_search_info ChessSearchInfo;
+
+typedef thc_archive ChessArchive;
+
+typedef thc_position_index ChessPositionIndex;
+
+typedef thc_position_stats ChessPositionStats;
+
 // initialize a chess board
 ChessBoard *chess_board_init();
 
@@ -19,12 +31,17 @@ void chess_board_destroy(ChessBoard *);
 
 // generate a list of legal moves
 // each move contains a src tile and a dst tile
+// the list is cached, so asking again before a move is cheap
 void chess_board_gen_movelist(const ChessBoard *, ChessMoveList *);
 
 // make a move
 // the move should generated by board_gen_legal_movelist
 void chess_board_move(const ChessBoard *, ChessMove);
 
+// changes whenever a move is made, compare versions to see if the
+// position has changed since it was last looked at
+uint64_t chess_board_version(const ChessBoard *);
+
 bool chess_board_white_to_play(const ChessBoard *);
 
 // get a string describing the board
@@ -32,4 +49,59 @@ bool chess_board_white_to_play(const ChessBoard *);
 // and spaces for empty tiles
 const char *chess_board_get_squares(const ChessBoard *);
 
+// cached like the move list
 ChessGameEnds chess_board_get_game_end(const ChessBoard *);
+
+// search for the best move for the side to play within budget
+// the move has src == dst if there are no legal moves
+ChessMove chess_board_best_move(const ChessBoard *, ChessSearchBudget);
+
+// memory used by the search to remember positions, in megabytes
+void chess_set_hash_size(uint32_t megabytes);
+
+// threads the search runs on, 0 for one per core
+void chess_set_search_threads(int threads);
+
+// a computer player that thinks on a background thread
+ChessEngine *chess_engine_init();
+
+// stops the engine if it is thinking
+void chess_engine_destroy(ChessEngine *);
+
+// start thinking about the board's position, stopping any earlier search
+// the board can be changed or destroyed while the engine thinks
+void chess_engine_start(ChessEngine *, const ChessBoard *, ChessSearchBudget);
+
+// ask the engine to finish thinking, poll for its answer
+void chess_engine_stop(ChessEngine *);
+
+// get the best move and pv found so far without waiting
+// returns true once the engine has finished, info then has its final answer
+bool chess_engine_poll(ChessEngine *, ChessSearchInfo *info);
+
+// record games to a binary archive file, NULL if it can't be created
+ChessArchive *chess_archive_create(const char *path);
+
+// record a move before it is made on the board
+// false if it isn't legal on the board or the game is too long to record
+bool chess_archive_add_move(ChessArchive *, const ChessBoard *, ChessMove);
+
+// write the recorded game with the board's result
+// a game that hasn't ended is written as unfinished
+bool chess_archive_end_game(ChessArchive *, const ChessBoard *);
+
+// finish the file and free the archive, false if anything failed to write
+bool chess_archive_close(ChessArchive *);
+
+// open an index of the positions in a game archive, NULL if it can't be read
+// lookups read only the few pages of the file they need
+ChessPositionIndex *chess_position_index_open(const char *path);
+
+void chess_position_index_close(ChessPositionIndex *);
+
+// results of the games reaching the board's position
+// the archive offsets of the first max games are written to games,
+// returns how many were written
+size_t chess_position_index_find(
+    ChessPositionIndex *, const ChessBoard *, ChessPositionStats *,
+    uint64_t *games, size_t max);
@@ -6,6 +6,7 @@
 
 #include "render_backend.h"
 #include <malloc.h>
+#include <string.h>
 
 #define alloc(type) (malloc(sizeof(type)))
 
@@ -13,6 +14,25 @@
 
 #define MOUSE_AVERAGE_SIZE 50
 
+// a piece's entry in Board.pieceSprites, plus one so 0 can mean no piece
+static const uint8_t PIECE_SPRITE[128] = {
+    ['K'] = 1, ['Q'] = 2, ['B'] = 3,  ['N'] = 4,  ['R'] = 5,  ['P'] = 6,
+    ['k'] = 7, ['q'] = 8, ['b'] = 9, ['n'] = 10, ['r'] = 11, ['p'] = 12,
+};
+
+// everything that decides how the board looks, the board is only drawn again
+// once this changes
+typedef struct BoardFrame
+{
+    uint64_t version; // of the chess board's position, 0 before any drawing
+    RenderRect boardRect;
+    ChessSquare mouseTile, hoveredTile;
+    size_t legalMoves;
+    bool dragging;
+    int dragX, dragY, dragAngle;
+    uint64_t statusVersion;
+} BoardFrame;
+
 struct Board
 {
     bool playerIsWhite;
@@ -29,17 +49,54 @@ struct Board
     ChessMoveList moveList;
 
     RenderRect boardRect;
+    BoardFrame drawn; // what the screen shows
+
+    // the board and its pieces, drawn once per position rather than every
+    // frame. the held piece is faded, so picking one up also rebuilds it
+    struct
+    {
+        RenderTexture *texture;
+        int w, h;
+        uint64_t version; // 0 when it must be rebuilt
+        ChessSquare hoveredTile;
+    } layer;
 
     RenderFont *defaultFont;
 
-    // textures
+    // a line of text under the board, NULL when there is none
+    RenderText *status;
+    uint64_t statusVersion; // bumped by every new status, so it is drawn
+
+    // every sprite is drawn from one atlas, so a whole layer of the board is
+    // a single batch
+    RenderTexture *atlas;
+    RenderBatch *batch;
     struct
     {
-        RenderTexture *board;
-        RenderTexture *pieces;
-        RenderTexture *hover;
-        RenderTexture *legalMove;
-    } textures;
+        RenderRect board;
+        RenderRect pieces;
+        RenderRect hover;
+        RenderRect legalMove;
+    } sprites; // where each texture is in the atlas
+    RenderRect pieceSprites[12]; // indexed through PIECE_SPRITE
+
+    // each square's rect on a board of this size at 0, 0
+    struct
+    {
+        int w, h;
+        RenderRect rects[64];
+    } tiles;
+};
+
+struct BoardGrid
+{
+    Board *board; // textures, sprites and batch shared with a single board
+    size_t count, columns, rows;
+    uint64_t *versions; // of each board as last drawn, 0 to draw it again
+
+    // the whole grid, kept between frames. NULL draws every board every time
+    RenderTexture *layer;
+    int w, h;
 };
 
 struct Button
@@ -48,6 +105,8 @@ struct Button
     BoardColour borderColour, backgroundColour;
     RenderText *buttonText;
     RenderRect position;
+    bool moved;        // since it was last drawn
+    bool drawnHovered; // the hover shading on screen
 };
 
 // drawing helpers
@@ -56,9 +115,50 @@ void drawBoard(
     Board *b,
     const ChessBoard *chessBoard,
     const RenderRect *rect,
-    const ChessMoveList *list,
-    bool playerIsWhite);
-RenderRect getPieceSrcRect(Board *r, char p);
+    const ChessMoveList *list);
+RenderRect getPieceSrcRect(const Board *r, char p);
+RenderRect calculatePieceSrcRect(const Board *r, char p);
+// where square is drawn on the board at boardRect, from the cached tiles
+RenderRect getTileRect(
+    const Board *b, const RenderRect *boardRect, ChessSquare square);
+void updateTileRects(Board *b, const RenderRect *boardRect);
+// draws the board and its pieces, the part of the board that only changes
+// with the position
+void drawBoardLayer(
+    const Render *render,
+    Board *b,
+    const ChessBoard *chessBoard,
+    const RenderRect *boardRect);
+// the square a board in the grid is drawn in, for a window of w by h
+RenderRect getGridCellRect(const BoardGrid *g, int w, int h, size_t index);
+// queue the board and its pieces on the board's batch
+void addBoardQuads(
+    Board *b,
+    const ChessBoard *chessBoard,
+    const RenderRect *boardRect,
+    ChessSquare fadedTile);
+// brings the cached layer up to date, false if there is no render target to
+// draw it into
+bool updateBoardLayer(
+    const Render *render,
+    Board *b,
+    const ChessBoard *chessBoard,
+    const RenderRect *boardRect);
+float getMouseAverage(const Board *b);
+float getDragRotation(const Board *b, int mouse_x);
+BoardFrame getBoardFrame(
+    const Render *render,
+    const Board *b,
+    const ChessBoard *chessBoard,
+    const ChessMoveList *list);
+bool sameBoardFrame(const BoardFrame *a, const BoardFrame *b);
+// the board's area in the window, leaving a small border and room for the
+// status line if there is one
+RenderRect calculateBoardRect(const Render *render, const Board *b);
+int getStatusHeight(const Render *render);
+// the status text's rect, centred under the board at boardRect
+RenderRect calculateStatusRect(
+    const Render *render, const Board *b, const RenderRect *boardRect);
 RenderRect getPieceDestRect(const RenderRect *boardRect, ChessSquare index);
 // calculate the rect for the largest square that could fit in a rectangle
 RenderRect calculateRenderRect(const RenderRect *frame);
@@ -87,17 +187,40 @@ Board *create_board(
     b->lmb               = RENDER_CURSOR_UP;
     b->playerIsWhite     = playerIsWhite;
     b->mouseAverageIndex = 0;
+    b->drawn             = (BoardFrame){.version = 0};
+    b->layer.texture     = NULL;
+    b->layer.version     = 0;
+    b->status            = NULL;
+    b->statusVersion     = 0;
+
+    // load piece textures, in the order of sprites
+    const char *const textures[] = {
+        boardTexture,
+        pieceTexture,
+        hoverTexture,
+        legalMoveTexture,
+    };
 
-    // load piece textures
-    b->textures.board     = render_create_texture(render, boardTexture);
-    b->textures.pieces    = render_create_texture(render, pieceTexture);
-    b->textures.hover     = render_create_texture(render, hoverTexture);
-    b->textures.legalMove = render_create_texture(render, legalMoveTexture);
+    RenderRect sprites[array_length(textures)];
+    b->atlas = render_create_atlas(
+        render, textures, array_length(textures), sprites);
     assert(
-        b->textures.board && b->textures.pieces && b->textures.hover &&
-        b->textures.legalMove && "All textures must have sucessfully loaded");
-    render_set_texture_alpha(b->textures.legalMove, 0x80);
-    assert(b->textures.board && b->textures.pieces);
+        b->atlas &&
+        "All textures must have sucessfully loaded and fit in one texture");
+
+    b->sprites.board     = sprites[0];
+    b->sprites.pieces    = sprites[1];
+    b->sprites.hover     = sprites[2];
+    b->sprites.legalMove = sprites[3];
+    b->batch             = render_create_batch(render);
+
+    const char pieces[] = "KQBNRPkqbnrp";
+    for (size_t i = 0; pieces[i] != 0; i++)
+    {
+        assert(PIECE_SPRITE[(uint8_t)pieces[i]] == i + 1);
+        b->pieceSprites[i] = calculatePieceSrcRect(b, pieces[i]);
+    }
+    b->tiles.w = b->tiles.h = -1;
 
     b->defaultFont = render_create_font(render, fontPath, UINT8_MAX);
     assert(b->defaultFont);
@@ -112,12 +235,14 @@ Board *create_board(
 
 void destroy_board(Board *r)
 {
+    if (r->status)
+        render_destroy_text(r->status);
     render_destroy_font(r->defaultFont);
 
-    render_destroy_texture(r->textures.board);
-    render_destroy_texture(r->textures.hover);
-    render_destroy_texture(r->textures.legalMove);
-    render_destroy_texture(r->textures.pieces);
+    render_destroy_batch(r->batch);
+    render_destroy_texture(r->atlas);
+    if (r->layer.texture)
+        render_destroy_texture(r->layer.texture);
 
     free(r);
 }
@@ -143,6 +268,8 @@ Button *create_button(
         .backgroundColour = background,
         .position         = *position,
         .buttonText       = textObj,
+        .moved            = true,
+        .drawnHovered     = false,
     };
 
     // change height
@@ -185,6 +312,13 @@ void button_set_pos(Button *button, uint16_t x, uint16_t y)
 {
     button->position.x = x;
     button->position.y = y;
+    button->moved      = true;
+}
+
+bool button_is_dirty(const Render *render, Button *button)
+{
+    return button->moved ||
+           buttonHovered(render, button) != button->drawnHovered;
 }
 
 void button_draw(const Render *render, Button *button)
@@ -228,6 +362,9 @@ void button_draw(const Render *render, Button *button)
 
     // draw text
     render_draw_text(render, button->buttonText, &textRect);
+
+    button->moved        = false;
+    button->drawnHovered = hovered;
 }
 
 void destroy_button(Button *b)
@@ -248,7 +385,8 @@ void board_update(const Render *render, Board *r, RenderEvent e)
     case RENDER_EVENT_WINDOW_RESIZE:
         render_get_render_size(render, &windowRect.w, &windowRect.h);
 
-        r->boardRect = calculateRenderRect(&windowRect);
+        r->boardRect     = calculateRenderRect(&windowRect);
+        r->layer.version = 0;
         break;
     default: break;
     }
@@ -256,83 +394,28 @@ void board_update(const Render *render, Board *r, RenderEvent e)
     r->lmb = render_get_cursor_state(render);
 }
 
-void board_draw(
-    const Render *render,
-    Board *board,
-    const ChessBoard *chessBoard,
-    const ChessMoveList *list)
+bool board_is_animating(const Board *b)
 {
-    assert(board);
-
-    int window_w, window_h;
-    render_get_render_size(render, &window_w, &window_h);
-
-    size_t padding = 10;
-
-    // padding must be even!!!
-    if (padding % 2 != 0)
-        padding++;
-
-    RenderRect board1 = {
-        .x = padding / 2,
-        .y = padding / 2,
-        .w = window_w - padding,
-        .h = window_h - padding,
-    };
-
-    // this shouldn't break, because board1 shouldn't be changed until after the
-    // function returns
-    board1 = calculateRenderRect(&board1);
-
-    drawBoard(render, board, chessBoard, &board1, list, board->playerIsWhite);
+    return b->hoveredPiece != ' ' &&
+           (b->lmb == RENDER_CURSOR_PRESSED || b->lmb == RENDER_CURSOR_DOWN);
 }
 
-void drawBoard(
+void board_handle_input(
     const Render *render,
     Board *b,
     const ChessBoard *chessBoard,
-    const RenderRect *boardRect,
-    const ChessMoveList *list,
-    bool playerIsWhite)
+    const ChessMoveList *list)
 {
-    // draw board
-    render_draw_texture(render, boardRect, NULL, b->textures.board, 0.f);
+    RenderRect boardRect = calculateBoardRect(render, b);
 
     int mouse_x, mouse_y;
     render_get_cursor_pos(render, &mouse_x, &mouse_y);
 
-    // highlight lastmove
+    ChessSquare mouseTile  = getMouseTile(render, &boardRect);
+    uint8_t mousePieceTile = !b->playerIsWhite ? 63 - mouseTile : mouseTile;
 
-    // highlight mouse hover
-    ChessSquare mouseTile  = getMouseTile(render, boardRect);
-    uint8_t mousePieceTile = !playerIsWhite ? 63 - mouseTile : mouseTile;
-    if (mouseTile < 64)
-    {
-        RenderRect mouseRect = getPieceDestRect(boardRect, mouseTile);
-        render_draw_texture(render, &mouseRect, NULL, b->textures.hover, 0.f);
-    }
-
-    // get board string
     const char *squares = chess_board_get_squares(chessBoard);
 
-    // draw pieces
-    for (size_t i = 0; squares[i] != 0; i++)
-    {
-        if (squares[i] != ' ')
-        {
-            RenderRect destRect = getPieceDestRect(boardRect, i);
-            RenderRect srcRect  = getPieceSrcRect(b, squares[i]);
-
-            size_t hovertile = b->hoveredTile;
-            if (b->hoveredTile != SQUARE_INVALID && i == hovertile)
-                render_set_texture_alpha(b->textures.pieces, 0x80);
-            render_draw_texture(
-                render, &destRect, &srcRect, b->textures.pieces, 0);
-            if (b->hoveredTile != SQUARE_INVALID && i == hovertile)
-                render_set_texture_alpha(b->textures.pieces, 0xff);
-        }
-    }
-
     // get hovered piece
     if (mouseTile < 64 && b->lmb == RENDER_CURSOR_PRESSED &&
         (squares[mouseTile] != ' ' &&
@@ -366,20 +449,99 @@ void drawBoard(
         b->hoveredTile  = SQUARE_INVALID;
     }
 
+    // slowly move average back to mouse position when mouse is stopped
+    if (board_is_animating(b) && getMouseAverage(b) != mouse_x)
+    {
+        assert(b->mouseAverageIndex < MOUSE_AVERAGE_SIZE);
+        b->mouseAverage[b->mouseAverageIndex] = mouse_x;
+        b->mouseAverageIndex = (b->mouseAverageIndex + 1) % MOUSE_AVERAGE_SIZE;
+    }
+}
+
+bool board_is_dirty(
+    const Render *render,
+    const Board *b,
+    const ChessBoard *chessBoard,
+    const ChessMoveList *list)
+{
+    BoardFrame frame = getBoardFrame(render, b, chessBoard, list);
+    return !sameBoardFrame(&frame, &b->drawn);
+}
+
+void board_draw(
+    const Render *render,
+    Board *board,
+    const ChessBoard *chessBoard,
+    const ChessMoveList *list)
+{
+    assert(board);
+
+    RenderRect boardRect = calculateBoardRect(render, board);
+
+    drawBoard(render, board, chessBoard, &boardRect, list);
+    if (board->status)
+    {
+        RenderRect statusRect = calculateStatusRect(render, board, &boardRect);
+        render_draw_text(render, board->status, &statusRect);
+    }
+    board->drawn = getBoardFrame(render, board, chessBoard, list);
+}
+
+void board_set_status(const Render *render, Board *b, const char *text)
+{
+    if (b->status)
+        render_destroy_text(b->status);
+    b->status = NULL;
+    if (text)
+        b->status = render_create_text(
+            render, b->defaultFont, text, 0xc0, 0xc0, 0xc0);
+    b->statusVersion++;
+}
+
+void drawBoard(
+    const Render *render,
+    Board *b,
+    const ChessBoard *chessBoard,
+    const RenderRect *boardRect,
+    const ChessMoveList *list)
+{
+    updateTileRects(b, boardRect);
+
+    // draw board and pieces, straight to the window if targets don't work
+    if (updateBoardLayer(render, b, chessBoard, boardRect))
+        render_draw_texture(render, boardRect, NULL, b->layer.texture, 0.f);
+    else
+        drawBoardLayer(render, b, chessBoard, boardRect);
+
+    int mouse_x, mouse_y;
+    render_get_cursor_pos(render, &mouse_x, &mouse_y);
+
+    render_batch_begin(b->batch, b->atlas);
+
+    // highlight lastmove
+
+    // highlight mouse hover, over the pieces as they are in the layer
+    ChessSquare mouseTile = getMouseTile(render, boardRect);
+    if (mouseTile < 64)
+    {
+        RenderRect mouseRect = getTileRect(b, boardRect, mouseTile);
+        render_batch_add(
+            b->batch, &mouseRect, &b->sprites.hover, 0.f, UINT8_MAX);
+    }
+
     for (size_t i = 0; b->hoveredTile != SQUARE_INVALID && i < list->count; i++)
     {
         if (list->moves[i].src == b->hoveredTile)
         {
             const RenderRect tileRect =
-                getPieceDestRect(boardRect, list->moves[i].dst);
-            render_draw_texture(
-                render, &tileRect, NULL, b->textures.legalMove, 0.f);
+                getTileRect(b, boardRect, list->moves[i].dst);
+            render_batch_add(
+                b->batch, &tileRect, &b->sprites.legalMove, 0.f, 0x80);
         }
     }
 
     // draw hovered piece
-    if ((b->hoveredPiece) != ' ' &&
-        (b->lmb == RENDER_CURSOR_PRESSED || b->lmb == RENDER_CURSOR_DOWN))
+    if (board_is_animating(b))
     {
         RenderRect dragPieceRect = {
             .x = mouse_x - boardRect->w / 12,
@@ -387,41 +549,342 @@ void drawBoard(
             .w = boardRect->w / 6,
             .h = boardRect->h / 6,
         };
-        // calculate average mouse position
-        float mouseAverageTotal = 0xf;
-        for (size_t i = 0; i < MOUSE_AVERAGE_SIZE; i++)
-            mouseAverageTotal += b->mouseAverage[i];
-        mouseAverageTotal /= MOUSE_AVERAGE_SIZE;
-
-        float rotation = (mouse_x - mouseAverageTotal) * 1.f;
-        rotation       = (90.f / (M_PI / 2.f)) * atan(rotation / 32.f);
+        float rotation = getDragRotation(b, mouse_x);
 
         RenderRect pieceRect = getPieceSrcRect(b, b->hoveredPiece);
-        render_set_texture_alpha(b->textures.pieces, 64 * 3);
-        render_draw_texture(
-            render, &dragPieceRect, &pieceRect, b->textures.pieces, rotation);
-        render_set_texture_alpha(b->textures.pieces, UINT8_MAX);
+        render_batch_add(
+            b->batch, &dragPieceRect, &pieceRect, rotation, 64 * 3);
+    }
+
+    render_batch_flush(b->batch);
+}
+
+void drawBoardLayer(
+    const Render *render,
+    Board *b,
+    const ChessBoard *chessBoard,
+    const RenderRect *boardRect)
+{
+    render_batch_begin(b->batch, b->atlas);
+    addBoardQuads(b, chessBoard, boardRect, b->hoveredTile);
+    render_batch_flush(b->batch);
+}
 
-        // slowly move average back to mouse position when mouse is stopped
-        if (mouseAverageTotal != mouse_x)
+void addBoardQuads(
+    Board *b,
+    const ChessBoard *chessBoard,
+    const RenderRect *boardRect,
+    ChessSquare fadedTile)
+{
+    updateTileRects(b, boardRect);
+
+    render_batch_add(b->batch, boardRect, &b->sprites.board, 0.f, UINT8_MAX);
+
+    // get board string
+    const char *squares = chess_board_get_squares(chessBoard);
+
+    // draw pieces, the held piece faded
+    for (size_t i = 0; squares[i] != 0; i++)
+    {
+        if (squares[i] != ' ')
         {
-            assert(b->mouseAverageIndex < MOUSE_AVERAGE_SIZE);
-            b->mouseAverage[b->mouseAverageIndex] = mouse_x;
-            b->mouseAverageIndex =
-                (b->mouseAverageIndex + 1) % MOUSE_AVERAGE_SIZE;
+            RenderRect destRect = getTileRect(b, boardRect, i);
+            RenderRect srcRect  = getPieceSrcRect(b, squares[i]);
+
+            uint8_t alpha = UINT8_MAX;
+            if (fadedTile != SQUARE_INVALID && i == fadedTile)
+                alpha = 0x80;
+            render_batch_add(b->batch, &destRect, &srcRect, 0.f, alpha);
         }
     }
 }
 
-RenderRect getPieceSrcRect(Board *r, char p)
+bool updateBoardLayer(
+    const Render *render,
+    Board *b,
+    const ChessBoard *chessBoard,
+    const RenderRect *boardRect)
+{
+    uint64_t version = chess_board_version(chessBoard);
+    if (b->layer.texture && b->layer.version == version &&
+        b->layer.hoveredTile == b->hoveredTile && b->layer.w == boardRect->w &&
+        b->layer.h == boardRect->h)
+        return true;
+
+    if (b->layer.texture &&
+        (b->layer.w != boardRect->w || b->layer.h != boardRect->h))
+    {
+        render_destroy_texture(b->layer.texture);
+        b->layer.texture = NULL;
+    }
+    if (!b->layer.texture)
+    {
+        b->layer.texture =
+            render_create_target(render, boardRect->w, boardRect->h);
+        b->layer.w       = boardRect->w;
+        b->layer.h       = boardRect->h;
+    }
+    if (!b->layer.texture ||
+        render_set_target(render, b->layer.texture) == RENDER_FAILURE)
+        return false;
+
+    RenderRect layerRect = {.x = 0, .y = 0, .w = b->layer.w, .h = b->layer.h};
+    render_set_colour(render, 0, 0, 0, 0);
+    render_clear(render);
+    drawBoardLayer(render, b, chessBoard, &layerRect);
+    render_set_target(render, NULL);
+
+    b->layer.version     = version;
+    b->layer.hoveredTile = b->hoveredTile;
+    return true;
+}
+
+BoardGrid *
+create_board_grid(const Render *render, Board *board, size_t count)
+{
+    assert(board && count > 0);
+
+    BoardGrid *g = alloc(BoardGrid);
+    g->board     = board;
+    g->count     = count;
+
+    // as close to square as it can be, with any spare cells on the last row
+    g->columns = 1;
+    while (g->columns * g->columns < count)
+        g->columns++;
+    g->rows = (count + g->columns - 1) / g->columns;
+
+    g->versions = calloc(count, sizeof(uint64_t));
+    g->layer    = NULL;
+    g->w        = 0;
+    g->h        = 0;
+    return g;
+}
+
+void destroy_board_grid(BoardGrid *g)
+{
+    if (g->layer)
+        render_destroy_texture(g->layer);
+    free(g->versions);
+    free(g);
+}
+
+void board_grid_update(BoardGrid *g, RenderEvent e)
+{
+    // the layer's contents are lost, not just its size. the next draw makes
+    // and clears a new one, so the gaps between boards are cleared as well
+    if (e == RENDER_EVENT_WINDOW_RESIZE && g->layer)
+    {
+        render_destroy_texture(g->layer);
+        g->layer = NULL;
+    }
+}
+
+bool board_grid_is_dirty(
+    const Render *render, const BoardGrid *g, const ChessBoard *const *boards)
+{
+    int w, h;
+    render_get_render_size(render, &w, &h);
+    if (!g->layer || w != g->w || h != g->h)
+        return true;
+
+    for (size_t i = 0; i < g->count; i++)
+    {
+        if (chess_board_version(boards[i]) != g->versions[i])
+            return true;
+    }
+    return false;
+}
+
+void board_grid_draw(
+    const Render *render, BoardGrid *g, const ChessBoard *const *boards)
+{
+    int w, h;
+    render_get_render_size(render, &w, &h);
+
+    bool cleared = false;
+    if (!g->layer || w != g->w || h != g->h)
+    {
+        if (g->layer)
+            render_destroy_texture(g->layer);
+        g->layer = render_create_target(render, w, h);
+        g->w     = w;
+        g->h     = h;
+        cleared  = true;
+    }
+
+    bool toLayer = g->layer && render_set_target(render, g->layer) ==
+                                   RENDER_SUCCESS;
+    if (toLayer && cleared)
+    {
+        render_set_colour(render, 0, 0, 0, 0);
+        render_clear(render);
+        memset(g->versions, 0, g->count * sizeof(uint64_t));
+    }
+
+    // every changed board goes in one batch
+    Board *b = g->board;
+    render_batch_begin(b->batch, b->atlas);
+    for (size_t i = 0; i < g->count; i++)
+    {
+        uint64_t version = chess_board_version(boards[i]);
+        if (toLayer && version == g->versions[i])
+            continue;
+
+        RenderRect cell = getGridCellRect(g, w, h, i);
+        addBoardQuads(b, boards[i], &cell, SQUARE_INVALID);
+        g->versions[i] = version;
+    }
+    render_batch_flush(b->batch);
+
+    if (toLayer)
+    {
+        render_set_target(render, NULL);
+        RenderRect windowRect = {.x = 0, .y = 0, .w = w, .h = h};
+        render_draw_texture(render, &windowRect, NULL, g->layer, 0.f);
+    }
+}
+
+RenderRect getGridCellRect(const BoardGrid *g, int w, int h, size_t index)
+{
+    // square cells, the grid centred in the window
+    int size = w / (int)g->columns;
+    if (h / (int)g->rows < size)
+        size = h / (int)g->rows;
+    int x = (w - size * (int)g->columns) / 2;
+    int y = (h - size * (int)g->rows) / 2;
+
+    // a gap between boards, small enough for dozens of them
+    int padding = size / 32 + 1;
+
+    return (RenderRect){
+        .x = x + (int)(index % g->columns) * size + padding,
+        .y = y + (int)(index / g->columns) * size + padding,
+        .w = size - padding * 2,
+        .h = size - padding * 2,
+    };
+}
+
+float getMouseAverage(const Board *b)
+{
+    float mouseAverageTotal = 0xf;
+    for (size_t i = 0; i < MOUSE_AVERAGE_SIZE; i++)
+        mouseAverageTotal += b->mouseAverage[i];
+    return mouseAverageTotal / MOUSE_AVERAGE_SIZE;
+}
+
+float getDragRotation(const Board *b, int mouse_x)
+{
+    float rotation = (mouse_x - getMouseAverage(b)) * 1.f;
+    return (90.f / (M_PI / 2.f)) * atan(rotation / 32.f);
+}
+
+BoardFrame getBoardFrame(
+    const Render *render,
+    const Board *b,
+    const ChessBoard *chessBoard,
+    const ChessMoveList *list)
+{
+    RenderRect boardRect = calculateBoardRect(render, b);
+
+    BoardFrame frame = {
+        .version       = chess_board_version(chessBoard),
+        .boardRect     = boardRect,
+        .mouseTile     = getMouseTile(render, &boardRect),
+        .hoveredTile   = b->hoveredTile,
+        .legalMoves    = list->count,
+        .dragging      = board_is_animating(b),
+        .statusVersion = b->statusVersion,
+    };
+
+    // the dragged piece follows the mouse and swings as it moves
+    if (frame.dragging)
+    {
+        render_get_cursor_pos(render, &frame.dragX, &frame.dragY);
+        frame.dragAngle = (int)roundf(getDragRotation(b, frame.dragX));
+    }
+    return frame;
+}
+
+bool sameBoardFrame(const BoardFrame *a, const BoardFrame *b)
+{
+    return a->version == b->version &&
+           a->boardRect.x == b->boardRect.x &&
+           a->boardRect.y == b->boardRect.y &&
+           a->boardRect.w == b->boardRect.w &&
+           a->boardRect.h == b->boardRect.h && a->mouseTile == b->mouseTile &&
+           a->hoveredTile == b->hoveredTile &&
+           a->legalMoves == b->legalMoves && a->dragging == b->dragging &&
+           a->dragX == b->dragX && a->dragY == b->dragY &&
+           a->dragAngle == b->dragAngle &&
+           a->statusVersion == b->statusVersion;
+}
+
+RenderRect calculateBoardRect(const Render *render, const Board *b)
+{
+    int window_w, window_h;
+    render_get_render_size(render, &window_w, &window_h);
+
+    size_t padding = 10;
+
+    // padding must be even!!!
+    if (padding % 2 != 0)
+        padding++;
+
+    RenderRect board1 = {
+        .x = padding / 2,
+        .y = padding / 2,
+        .w = window_w - padding,
+        .h = window_h - padding - (b->status ? getStatusHeight(render) : 0),
+    };
+
+    return calculateRenderRect(&board1);
+}
+
+int getStatusHeight(const Render *render)
+{
+    int window_w, window_h;
+    render_get_render_size(render, &window_w, &window_h);
+    return window_h / 20;
+}
+
+RenderRect calculateStatusRect(
+    const Render *render, const Board *b, const RenderRect *boardRect)
+{
+    // as tall as the space under the board, unless that is too wide for it
+    float aspect = render_text_get_aspect_ratio(b->status);
+    int space    = getStatusHeight(render);
+    int h        = space;
+    int w        = (int)(h * aspect);
+    if (w > boardRect->w)
+    {
+        w = boardRect->w;
+        h = (int)(w / aspect);
+    }
+
+    return (RenderRect){
+        .x = boardRect->x + (boardRect->w - w) / 2,
+        .y = boardRect->y + boardRect->h + (space - h) / 2,
+        .w = w,
+        .h = h,
+    };
+}
+
+RenderRect getPieceSrcRect(const Board *r, char p)
+{
+    uint8_t sprite = PIECE_SPRITE[(uint8_t)p & 0x7f];
+    assert(sprite && "Invalid piece should not be used");
+    return r->pieceSprites[sprite - 1];
+}
+
+RenderRect calculatePieceSrcRect(const Board *r, char p)
 {
     assert(isalpha(p) || p == ' ');
 
-    int textureSize[2];
-    render_get_texture_size(
-        r->textures.pieces, &textureSize[0], &textureSize[1]);
-    int x           = 0;
-    const int sixth = textureSize[0] / 6;
+    const RenderRect *sheet  = &r->sprites.pieces;
+    const int textureSize[2] = {sheet->w, sheet->h};
+    int x                    = 0;
+    const int sixth          = textureSize[0] / 6;
     switch (tolower(p))
     {
     case ' ': x = 0; break;
@@ -438,8 +901,8 @@ RenderRect getPieceSrcRect(Board *r, char p)
     int y = p == tolower(p) ? textureSize[1] / 2 : 0;
 
     RenderRect srcRect = {
-        .x = x,
-        .y = y,
+        .x = sheet->x + x,
+        .y = sheet->y + y,
         .w = sixth,
         .h = textureSize[1] / 2,
     };
@@ -453,6 +916,33 @@ RenderRect getPieceSrcRect(Board *r, char p)
     return srcRect;
 }
 
+RenderRect getTileRect(
+    const Board *b, const RenderRect *boardRect, ChessSquare square)
+{
+    assert(b->tiles.w == boardRect->w && b->tiles.h == boardRect->h);
+    RenderRect rect = b->tiles.rects[square];
+    rect.x += boardRect->x;
+    rect.y += boardRect->y;
+    return rect;
+}
+
+void updateTileRects(Board *b, const RenderRect *boardRect)
+{
+    if (b->tiles.w == boardRect->w && b->tiles.h == boardRect->h)
+        return;
+
+    const RenderRect origin = {
+        .x = 0,
+        .y = 0,
+        .w = boardRect->w,
+        .h = boardRect->h,
+    };
+    for (ChessSquare i = 0; i < 64; i++)
+        b->tiles.rects[i] = getPieceDestRect(&origin, i);
+    b->tiles.w = boardRect->w;
+    b->tiles.h = boardRect->h;
+}
+
 RenderRect
 getPieceDestRect(const RenderRect *boardRect, const ChessSquare square)
 {
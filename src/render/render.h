@@ -11,6 +11,7 @@
 #include "render_backend.h"
 
 typedef struct Board Board;
+typedef struct BoardGrid BoardGrid;
 typedef struct Button Button;
 
 typedef struct BoardRect
@@ -46,11 +47,57 @@ Button *create_button(
 bool button_clicked(const Render *render, Button *button);
 void button_draw(const Render *R, Button *button);
 
+// true if the button would look different to when it was last drawn
+bool button_is_dirty(const Render *render, Button *button);
+
 void destroy_button(Button *button);
 void button_set_pos(Button *button, uint16_t x, uint16_t y);
 
 void board_update(const Render *render, Board *board, RenderEvent e);
 
+// true while a piece is being dragged, it moves between input events
+bool board_is_animating(const Board *board);
+
+// pick up and drop pieces with the mouse, a piece dropped on a square that
+// makes a move in list plays it on chessBoard
+void board_handle_input(
+    const Render *render,
+    Board *board,
+    const ChessBoard *chessBoard,
+    const ChessMoveList *list);
+
+// true if drawing now would look different to the last board_draw, e.g. after
+// a move, the mouse moving to another tile or the window resizing
+bool board_is_dirty(
+    const Render *render,
+    const Board *board,
+    const ChessBoard *chessBoard,
+    const ChessMoveList *list);
+
+// many boards in one window, e.g. to watch engine matches. they are drawn
+// with board's textures, so board must outlive the grid
+BoardGrid *
+create_board_grid(const Render *render, Board *board, size_t count);
+void destroy_board_grid(BoardGrid *grid);
+
+void board_grid_update(BoardGrid *grid, RenderEvent e);
+
+// true if any of the grid's count boards has moved since it was last drawn
+bool board_grid_is_dirty(
+    const Render *render,
+    const BoardGrid *grid,
+    const ChessBoard *const *boards);
+
+// draws the boards in a grid filling the window. only boards whose position
+// changed are drawn again, the rest are kept from the last draw
+void board_grid_draw(
+    const Render *render, BoardGrid *grid, const ChessBoard *const *boards);
+
+// a line of text drawn under the board, e.g. how the games that reached its
+// position ended. NULL removes it and the board fills the window again
+void board_set_status(const Render *render, Board *board, const char *text);
+
+// only draws, input is handled by board_handle_input
 void board_draw(
     const Render *render,
     Board *b,
@@ -7,6 +7,7 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <malloc.h>
+#include <math.h>
 
 #define alloc(type) (malloc(sizeof(type)));
 
@@ -30,6 +31,16 @@ struct RenderTexture
     SDL_Texture *sdl_texture;
 };
 
+struct RenderBatch
+{
+    const Render *render;
+    SDL_Texture *sdl_texture;
+    int texture_w, texture_h;
+    SDL_Vertex *vertices; // 4 per quad
+    int *indices;         // 6 per quad
+    size_t count, capacity;
+};
+
 struct RenderFont
 {
     TTF_Font *sdl_font;
@@ -256,55 +267,111 @@ void render_submit(const Render *render)
     SDL_RenderPresent(render->sdl_render);
 }
 
-RenderEvent render_poll_events(Render *render)
+// a press or release only lasts for the frame it happened in
+static void advance_cursor_state(Render *render)
 {
-
-    // update the cursor state
     if (render->cursor_state == RENDER_CURSOR_PRESSED)
         render->cursor_state = RENDER_CURSOR_DOWN;
 
     if (render->cursor_state == RENDER_CURSOR_RELEASED)
         render->cursor_state = RENDER_CURSOR_UP;
+}
 
-    RenderEvent ret = RENDER_EVENT_NONE;
-
-    SDL_Event e;
-    while (SDL_PollEvent(&e))
+static RenderEvent handle_event(Render *render, const SDL_Event *event)
+{
+    RenderEvent ret   = RENDER_EVENT_NONE;
+    const SDL_Event e = *event;
+    switch (e.type)
     {
-        switch (e.type)
+    case SDL_WINDOWEVENT:
+        switch (e.window.event)
         {
-        case SDL_WINDOWEVENT:
-            switch (e.window.event)
-            {
-            case SDL_WINDOWEVENT_RESIZED:
-                render->pixel_scale =
-                    calculate_pixel_scale(render->window, render);
-                // set return if higher priotety
-                if (RENDER_EVENT_WINDOW_RESIZE > ret)
-                    ret = RENDER_EVENT_WINDOW_RESIZE;
-                break;
-            case SDL_WINDOWEVENT_DISPLAY_CHANGED:
-                render->pixel_scale =
-                    calculate_pixel_scale(render->window, render);
-                break;
-            }
-            break;
-        case SDL_MOUSEBUTTONDOWN:
-            render->cursor_state = RENDER_CURSOR_PRESSED;
+        case SDL_WINDOWEVENT_RESIZED:
+            render->pixel_scale = calculate_pixel_scale(render->window, render);
+            ret                 = RENDER_EVENT_WINDOW_RESIZE;
             break;
-        case SDL_MOUSEBUTTONUP:
-            render->cursor_state = RENDER_CURSOR_RELEASED;
+        case SDL_WINDOWEVENT_EXPOSED: ret = RENDER_EVENT_WINDOW_EXPOSED; break;
+        case SDL_WINDOWEVENT_DISPLAY_CHANGED:
+            render->pixel_scale = calculate_pixel_scale(render->window, render);
             break;
-        case SDL_MOUSEMOTION:
-            render->cursor_x = e.motion.x;
-            render->cursor_y = e.motion.y;
-            break;
-        case SDL_QUIT: ret = RENDER_EVENT_QUIT; break;
         }
+        break;
+    // targets lose their contents, everything is built again as on a resize
+    case SDL_RENDER_TARGETS_RESET: ret = RENDER_EVENT_WINDOW_RESIZE; break;
+    case SDL_MOUSEBUTTONDOWN:
+        render->cursor_state = RENDER_CURSOR_PRESSED;
+        break;
+    case SDL_MOUSEBUTTONUP:
+        render->cursor_state = RENDER_CURSOR_RELEASED;
+        break;
+    case SDL_MOUSEMOTION:
+        render->cursor_x = e.motion.x;
+        render->cursor_y = e.motion.y;
+        break;
+    case SDL_QUIT: ret = RENDER_EVENT_QUIT; break;
     }
     return ret;
 }
 
+// several events can arrive in one frame, a quit is never dropped and a
+// resize redraws everything an expose would
+static RenderEvent merge_events(RenderEvent a, RenderEvent b)
+{
+    if (a == RENDER_EVENT_QUIT || b == RENDER_EVENT_NONE)
+        return a;
+    if (a == RENDER_EVENT_WINDOW_RESIZE && b == RENDER_EVENT_WINDOW_EXPOSED)
+        return a;
+    return b;
+}
+
+RenderEvent render_poll_events(Render *render)
+{
+    advance_cursor_state(render);
+
+    RenderEvent ret = RENDER_EVENT_NONE;
+
+    SDL_Event e;
+    while (SDL_PollEvent(&e))
+        ret = merge_events(ret, handle_event(render, &e));
+    return ret;
+}
+
+RenderEvent render_wait_events(Render *render, int timeout_ms)
+{
+    advance_cursor_state(render);
+
+    SDL_Event e;
+    int got = timeout_ms < 0 ? SDL_WaitEvent(&e)
+                             : SDL_WaitEventTimeout(&e, timeout_ms);
+    if (!got)
+        return RENDER_EVENT_NONE;
+
+    // then take whatever else is queued, as a poll would
+    RenderEvent ret = handle_event(render, &e);
+    while (SDL_PollEvent(&e))
+        ret = merge_events(ret, handle_event(render, &e));
+    return ret;
+}
+
+RenderResult render_set_vsync(const Render *render, bool vsync)
+{
+    return SDL_RenderSetVSync(render->sdl_render, vsync) == 0
+               ? RENDER_SUCCESS
+               : RENDER_FAILURE;
+}
+
+uint64_t render_get_time_us()
+{
+    // the counter can be in nanoseconds of uptime, so multiplying it first
+    // would overflow after a few hours
+    uint64_t count     = SDL_GetPerformanceCounter();
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+    return count / frequency * 1000000 +
+           count % frequency * 1000000 / frequency;
+}
+
+void render_sleep_us(uint64_t us) { SDL_Delay(us / 1000); }
+
 RenderTexture *
 render_create_texture(const Render *render, const char *texture_path)
 {
@@ -322,6 +389,122 @@ render_create_texture(const Render *render, const char *texture_path)
         return t;
 }
 
+RenderTexture *render_create_target(const Render *render, int w, int h)
+{
+    RenderTexture *t = alloc(RenderTexture);
+
+    t->sdl_texture = SDL_CreateTexture(
+        render->sdl_render,
+        SDL_PIXELFORMAT_RGBA8888,
+        SDL_TEXTUREACCESS_TARGET,
+        w * render->pixel_scale,
+        h * render->pixel_scale);
+
+    if (t->sdl_texture == NULL)
+    {
+        free(t);
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(t->sdl_texture, SDL_BLENDMODE_BLEND);
+    return t;
+}
+
+RenderResult
+render_set_target(const Render *render, const RenderTexture *target)
+{
+    SDL_Texture *sdl_target = target ? target->sdl_texture : NULL;
+    return SDL_SetRenderTarget(render->sdl_render, sdl_target) == 0
+               ? RENDER_SUCCESS
+               : RENDER_FAILURE;
+}
+
+RenderTexture *render_create_atlas(
+    const Render *render,
+    const char *const *texture_paths,
+    size_t n,
+    RenderRect *rects)
+{
+    // loaded as surfaces and packed in memory, the atlas is a static texture
+    // so a reset of the render targets can't wipe it
+    SDL_Surface **images = calloc(n, sizeof(SDL_Surface *));
+    bool loaded          = images != NULL;
+    for (size_t i = 0; loaded && i < n; i++)
+    {
+        SDL_Surface *image = IMG_Load(texture_paths[i]);
+        if (image)
+        {
+            images[i] =
+                SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
+            SDL_FreeSurface(image);
+        }
+        loaded = images[i] != NULL;
+    }
+
+    RenderTexture *t = NULL;
+    if (loaded)
+    {
+        // shelves as wide as the widest image, each as tall as its first
+        int shelf_w = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            rects[i].w = images[i]->w;
+            rects[i].h = images[i]->h;
+            if (rects[i].w > shelf_w)
+                shelf_w = rects[i].w;
+        }
+        int x = 0, y = 0, shelf_h = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (x + rects[i].w > shelf_w)
+            {
+                x = 0;
+                y += shelf_h;
+                shelf_h = 0;
+            }
+            rects[i].x = x;
+            rects[i].y = y;
+            x += rects[i].w;
+            if (rects[i].h > shelf_h)
+                shelf_h = rects[i].h;
+        }
+
+        SDL_Surface *sheet = SDL_CreateRGBSurfaceWithFormat(
+            0, shelf_w, y + shelf_h, 32, SDL_PIXELFORMAT_RGBA32);
+        if (sheet)
+        {
+            // copied as they are, alpha included, onto a clear sheet
+            SDL_FillRect(sheet, NULL, 0);
+            for (size_t i = 0; i < n; i++)
+            {
+                // a blit writes back the clipped rect, so it gets a copy
+                SDL_Rect dst = *(SDL_Rect *)&rects[i];
+                SDL_SetSurfaceBlendMode(images[i], SDL_BLENDMODE_NONE);
+                SDL_BlitSurface(images[i], NULL, sheet, &dst);
+            }
+
+            t              = alloc(RenderTexture);
+            t->sdl_texture =
+                SDL_CreateTextureFromSurface(render->sdl_render, sheet);
+            if (t->sdl_texture == NULL)
+            {
+                free(t);
+                t = NULL;
+            }
+            else
+                SDL_SetTextureBlendMode(t->sdl_texture, SDL_BLENDMODE_BLEND);
+            SDL_FreeSurface(sheet);
+        }
+    }
+
+    for (size_t i = 0; images && i < n; i++)
+    {
+        if (images[i])
+            SDL_FreeSurface(images[i]);
+    }
+    free(images);
+    return t;
+}
+
 void render_destroy_texture(RenderTexture *texture)
 {
     SDL_DestroyTexture(texture->sdl_texture);
@@ -344,6 +527,106 @@ RenderResult render_get_texture_size(const RenderTexture *t, int *w, int *h)
     return RENDER_SUCCESS;
 }
 
+RenderBatch *render_create_batch(const Render *render)
+{
+    RenderBatch *batch = alloc(RenderBatch);
+    *batch             = (RenderBatch){.render = render};
+    return batch;
+}
+
+void render_destroy_batch(RenderBatch *batch)
+{
+    free(batch->vertices);
+    free(batch->indices);
+    free(batch);
+}
+
+void render_batch_begin(RenderBatch *batch, const RenderTexture *texture)
+{
+    batch->sdl_texture = texture->sdl_texture;
+    SDL_QueryTexture(
+        batch->sdl_texture, NULL, NULL, &batch->texture_w, &batch->texture_h);
+    batch->count = 0;
+}
+
+void render_batch_add(
+    RenderBatch *batch,
+    const RenderRect *dst_rect,
+    const RenderRect *src_rect,
+    float angle,
+    uint8_t alpha)
+{
+    if (batch->count == batch->capacity)
+    {
+        batch->capacity = batch->capacity ? batch->capacity * 2 : 64;
+        batch->vertices = realloc(
+            batch->vertices, batch->capacity * 4 * sizeof(SDL_Vertex));
+        batch->indices =
+            realloc(batch->indices, batch->capacity * 6 * sizeof(int));
+    }
+
+    const float scale = batch->render->pixel_scale;
+    const float cx    = (dst_rect->x + dst_rect->w / 2.f) * scale;
+    const float cy    = (dst_rect->y + dst_rect->h / 2.f) * scale;
+    const float hw    = dst_rect->w / 2.f * scale;
+    const float hh    = dst_rect->h / 2.f * scale;
+
+    // clockwise about the centre, as SDL_RenderCopyEx does
+    const float radians = angle * (float)M_PI / 180.f;
+    const float c = cosf(radians), s = sinf(radians);
+
+    const float u0 = (float)src_rect->x / batch->texture_w;
+    const float v0 = (float)src_rect->y / batch->texture_h;
+    const float u1 = (float)(src_rect->x + src_rect->w) / batch->texture_w;
+    const float v1 = (float)(src_rect->y + src_rect->h) / batch->texture_h;
+
+    // corners in the order top left, top right, bottom right, bottom left
+    const float corners[4][4] = {
+        {-hw, -hh, u0, v0},
+        {hw, -hh, u1, v0},
+        {hw, hh, u1, v1},
+        {-hw, hh, u0, v1},
+    };
+
+    SDL_Vertex *v = &batch->vertices[batch->count * 4];
+    for (int i = 0; i < 4; i++)
+    {
+        const float dx = corners[i][0], dy = corners[i][1];
+        v[i] = (SDL_Vertex){
+            .position  = {cx + dx * c - dy * s, cy + dx * s + dy * c},
+            .color     = {0xff, 0xff, 0xff, alpha},
+            .tex_coord = {corners[i][2], corners[i][3]},
+        };
+    }
+
+    const int first = batch->count * 4;
+    int *index      = &batch->indices[batch->count * 6];
+    index[0]        = first;
+    index[1]        = first + 1;
+    index[2]        = first + 2;
+    index[3]        = first;
+    index[4]        = first + 2;
+    index[5]        = first + 3;
+
+    batch->count++;
+}
+
+RenderResult render_batch_flush(RenderBatch *batch)
+{
+    if (batch->count == 0)
+        return RENDER_SUCCESS;
+
+    int ret = SDL_RenderGeometry(
+        batch->render->sdl_render,
+        batch->sdl_texture,
+        batch->vertices,
+        batch->count * 4,
+        batch->indices,
+        batch->count * 6);
+    batch->count = 0;
+    return ret == 0 ? RENDER_SUCCESS : RENDER_FAILURE;
+}
+
 RenderFont *
 render_create_font(const Render *render, const char *font_path, uint8_t size)
 {
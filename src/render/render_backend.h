@@ -23,6 +23,7 @@ typedef enum
     RENDER_EVENT_NONE = 0,
     RENDER_EVENT_QUIT,
     RENDER_EVENT_WINDOW_RESIZE,
+    RENDER_EVENT_WINDOW_EXPOSED, // the window's contents must be drawn again
 } RenderEvent;
 
 // created in a window, can draw textures and boxes
@@ -34,6 +35,9 @@ typedef struct RenderWindow RenderWindow;
 // a texture loaded from a image file that can be drawn to the screen
 typedef struct RenderTexture RenderTexture;
 
+// quads drawn from one texture, submitted to the gpu together
+typedef struct RenderBatch RenderBatch;
+
 // a font loaded from a .ttf file used to create text
 typedef struct RenderFont RenderFont;
 
@@ -100,9 +104,58 @@ void render_submit(const Render *render);
 // should be called every frame to read mouse input and check for window close
 RenderEvent render_poll_events(Render *render);
 
+// like render_poll_events but sleeps until an event arrives or timeout_ms
+// passes, a negative timeout waits forever. RENDER_EVENT_NONE on timeout
+RenderEvent render_wait_events(Render *render, int timeout_ms);
+
+// wait for the display refresh when submitting. on by default
+RenderResult render_set_vsync(const Render *render, bool vsync);
+
+// a monotonic clock in microseconds, only differences are meaningful
+uint64_t render_get_time_us();
+
+// sleep the calling thread, at a granularity of about a millisecond
+void render_sleep_us(uint64_t us);
+
 RenderTexture *
 render_create_texture(const Render *render, const char *texture_path);
 void render_destroy_texture(RenderTexture *texture);
+
+// a blank texture that can be drawn into with render_set_target, sized in the
+// same units as the window. its contents are lost on a resize event
+RenderTexture *render_create_target(const Render *render, int w, int h);
+
+// send drawing to target until it is set again, NULL draws to the window
+RenderResult
+render_set_target(const Render *render, const RenderTexture *target);
+
+// load n images into one texture so they can be drawn by a single batch.
+// rects gets where each image ended up, in the atlas's pixels. the atlas is
+// not a render target, so it keeps its contents when targets are reset.
+// NULL for failure
+RenderTexture *render_create_atlas(
+    const Render *render,
+    const char *const *texture_paths,
+    size_t n,
+    RenderRect *rects);
+
+RenderBatch *render_create_batch(const Render *render);
+void render_destroy_batch(RenderBatch *batch);
+
+// start collecting quads from texture, usually an atlas
+void render_batch_begin(RenderBatch *batch, const RenderTexture *texture);
+
+// like render_draw_texture, but only queued until the batch is flushed. alpha
+// fades the quad without touching the texture
+void render_batch_add(
+    RenderBatch *batch,
+    const RenderRect *dst_rect,
+    const RenderRect *src_rect,
+    float angle,
+    uint8_t alpha);
+
+// draw every quad added since the last flush with one draw call
+RenderResult render_batch_flush(RenderBatch *batch);
 RenderResult
 render_set_texture_alpha(const RenderTexture *texture, uint8_t alpha);
 RenderResult render_get_texture_size(const RenderTexture *t, int *w, int *h);
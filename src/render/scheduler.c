@@ -0,0 +1,55 @@
+#include "scheduler.h"
+
+#include <malloc.h>
+
+#define alloc(type) (malloc(sizeof(type)))
+
+struct FrameScheduler
+{
+    Render *render;
+    uint64_t frameTime; // microseconds, 0 for no limit
+    uint64_t nextFrame; // when the next frame is due
+};
+
+FrameScheduler *
+create_scheduler(Render *render, unsigned targetFps, bool vsync)
+{
+    FrameScheduler *s = alloc(FrameScheduler);
+    s->render         = render;
+    s->frameTime      = targetFps ? 1000000 / targetFps : 0;
+    s->nextFrame      = render_get_time_us();
+
+    // without vsync support the target rate still limits the loop
+    render_set_vsync(render, vsync);
+    return s;
+}
+
+void destroy_scheduler(FrameScheduler *s) { free(s); }
+
+RenderEvent scheduler_next_frame(FrameScheduler *s, bool animating)
+{
+    uint64_t now = render_get_time_us();
+
+    if (!animating)
+    {
+        RenderEvent event = render_wait_events(s->render, -1);
+        s->nextFrame      = render_get_time_us() + s->frameTime;
+        return event;
+    }
+
+    // never more than a frame, even if the clock jumps back
+    if (now < s->nextFrame)
+    {
+        uint64_t wait = s->nextFrame - now;
+        render_sleep_us(wait < s->frameTime ? wait : s->frameTime);
+    }
+
+    // deadlines advance by a whole frame so the rate doesn't drift, but a
+    // frame that ran long doesn't make the following ones hurry to catch up,
+    // and a deadline left far ahead by the clock jumping back is pulled in
+    s->nextFrame += s->frameTime;
+    if (s->nextFrame < now || s->nextFrame - now > 2 * s->frameTime)
+        s->nextFrame = now + s->frameTime;
+
+    return render_poll_events(s->render);
+}
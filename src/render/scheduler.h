@@ -0,0 +1,21 @@
+#pragma once
+
+// paces the main loop
+//
+// while something on screen is moving frames are drawn at the target rate,
+// otherwise the loop sleeps until there is input so an idle window costs no
+// cpu
+
+#include "render_backend.h"
+
+typedef struct FrameScheduler FrameScheduler;
+
+// targetFps of 0 leaves the rate to vsync, or runs unlimited without it
+FrameScheduler *
+create_scheduler(Render *render, unsigned targetFps, bool vsync);
+void destroy_scheduler(FrameScheduler *s);
+
+// waits until the next frame is due and returns the events since the last
+// one. when animating is false nothing will change without input, so this
+// blocks on render_wait_events instead of drawing frames
+RenderEvent scheduler_next_frame(FrameScheduler *s, bool animating);
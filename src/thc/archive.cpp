@@ -0,0 +1,196 @@
+/****************************************************************************
+ * archive.cpp Binary game archive for thc
+ *  Headers are packed a byte at a time (see byteorder.h), so files read the
+ *  same whatever the host's byte order and structure padding.
+ ****************************************************************************/
+
+#include "archive.h"
+#include "byteorder.h"
+
+#include <string.h>
+
+namespace thc
+{
+
+static const char archive_magic[4] = {'C', '2', 'G', 'A'};
+
+// Archive order, src then dst then special
+static uint32_t archive_key(Move m)
+{
+    return ((uint32_t)m.src << 16) | ((uint32_t)m.dst << 8) |
+           (uint32_t)m.special;
+}
+
+int ArchiveMoveIndex(const MOVELIST &list, Move move)
+{
+    // The index is the number of legal moves that sort before this one
+    uint32_t key = archive_key(move);
+    int index    = 0;
+    bool found   = false;
+    for (int i = 0; i < list.count; i++)
+    {
+        uint32_t other = archive_key(list.moves[i]);
+        if (other < key)
+            index++;
+        else if (other == key)
+            found = true;
+    }
+    return found ? index : -1;
+}
+
+bool ArchiveMoveAt(const MOVELIST &list, int index, Move &move)
+{
+    if (index < 0 || index >= list.count)
+        return false;
+
+    // The order is by src first, so count moves a square to find the src
+    //  holding the index, then rank the few moves from it
+    uint8_t from[64] = {};
+    for (int i = 0; i < list.count; i++)
+        from[list.moves[i].src]++;
+    int src = 0;
+    while (index >= from[src])
+        index -= from[src++];
+
+    for (int i = 0; i < list.count; i++)
+    {
+        if (list.moves[i].src != src)
+            continue;
+        uint32_t key = archive_key(list.moves[i]);
+        int rank     = 0;
+        for (int j = 0; j < list.count; j++)
+        {
+            if (list.moves[j].src == src && archive_key(list.moves[j]) < key)
+                rank++;
+        }
+        if (rank == index)
+        {
+            move = list.moves[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool write_header(FILE *file, uint64_t games)
+{
+    uint8_t header[ARCHIVE_HEADER_SIZE] = {};
+    memcpy(header, archive_magic, 4);
+    put16(header + 4, ARCHIVE_VERSION);
+    put64(header + 8, games);
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool ArchiveWriter::Open(const char *path)
+{
+    Close();
+    games  = 0;
+    failed = false;
+    file   = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+    failed = !write_header(file, 0);
+    return !failed;
+}
+
+bool ArchiveWriter::Write(
+    const uint8_t *moves, size_t plies, ArchiveResult result)
+{
+    if (file == NULL || plies > ARCHIVE_MAX_PLIES)
+        return false;
+
+    uint8_t header[ARCHIVE_GAME_HEADER_SIZE] = {};
+    put16(header, (uint16_t)plies);
+    header[2] = (uint8_t)result;
+    bool ok   = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+              fwrite(moves, 1, plies, file) == plies;
+    failed = failed || !ok;
+    games += ok;
+    return ok;
+}
+
+bool ArchiveWriter::Close()
+{
+    if (file == NULL)
+        return !failed;
+
+    // The count goes back in the header once all the games are written
+    if (fseek(file, 0, SEEK_SET) != 0 || !write_header(file, games))
+        failed = true;
+    if (fclose(file) != 0)
+        failed = true;
+    file = NULL;
+    return !failed;
+}
+
+bool ArchiveReader::Open(const void *data, size_t size)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    if (size < ARCHIVE_HEADER_SIZE || memcmp(p, archive_magic, 4) != 0 ||
+        get16(p + 4) != ARCHIVE_VERSION)
+        return false;
+    games = get64(p + 8);
+    begin = p + ARCHIVE_HEADER_SIZE;
+    end   = p + size;
+    return true;
+}
+
+std::vector<const uint8_t *> ArchiveReader::Split(size_t n) const
+{
+    std::vector<const uint8_t *> bounds;
+    bounds.push_back(begin);
+
+    const uint8_t *p = begin;
+    ArchiveGame game;
+    for (size_t i = 1; i < n; i++)
+    {
+        const uint8_t *target = begin + (end - begin) * i / n;
+        while (p < target && Next(p, end, game))
+            ;
+        bounds.push_back(p);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+bool ArchiveReader::GameAt(uint64_t offset, ArchiveGame &game) const
+{
+    if (begin == NULL || offset < ARCHIVE_HEADER_SIZE ||
+        offset - ARCHIVE_HEADER_SIZE >= (uint64_t)(end - begin))
+        return false;
+    const uint8_t *p = begin + (offset - ARCHIVE_HEADER_SIZE);
+    return Next(p, end, game);
+}
+
+bool ArchiveReader::Next(
+    const uint8_t *&p, const uint8_t *run_end, ArchiveGame &game)
+{
+    if ((size_t)(run_end - p) < ARCHIVE_GAME_HEADER_SIZE)
+        return false;
+    size_t plies = get16(p);
+    if ((size_t)(run_end - p) - ARCHIVE_GAME_HEADER_SIZE < plies)
+        return false;
+
+    game.plies  = plies;
+    game.result = (ArchiveResult)p[2];
+    game.moves  = p + ARCHIVE_GAME_HEADER_SIZE;
+    p += ARCHIVE_GAME_HEADER_SIZE + plies;
+    return true;
+}
+
+bool ArchiveReader::Replay(const ArchiveGame &game, ChessRules &position)
+{
+    position = ChessRules();
+    MOVELIST list;
+    for (size_t i = 0; i < game.plies; i++)
+    {
+        Move move;
+        position.GenLegalMoveList(&list);
+        if (!ArchiveMoveAt(list, game.moves[i], move))
+            return false;
+        position.PlayMove(move);
+    }
+    return true;
+}
+
+} // namespace thc
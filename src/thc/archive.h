@@ -0,0 +1,124 @@
+/****************************************************************************
+ * archive.h Binary game archive for thc, about a byte a move
+ *  An archive is a 16 byte header, then games one after another. A game is
+ *  a 4 byte header, then a byte a ply: the index of the move played among
+ *  the position's legal moves sorted by src, dst then special. That order
+ *  doesn't depend on which move generator thc was built with, and there
+ *  are never more than 218 legal moves, so an index always fits a byte.
+ *
+ *  Archive header   "C2GA", uint16 version, uint16 0, uint64 game count
+ *  Game header      uint16 plies, uint8 ArchiveResult, uint8 0
+ *
+ *  Numbers are little endian. Every game starts from the standard position.
+ *  The game count is only written when the archive is closed, readers walk
+ *  the games to the end of the file rather than trust it.
+ ****************************************************************************/
+#ifndef THC_ARCHIVE_H
+#define THC_ARCHIVE_H
+
+#include "thc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+// TripleHappyChess
+namespace thc
+{
+
+const uint16_t ARCHIVE_VERSION        = 1;
+const size_t ARCHIVE_HEADER_SIZE      = 16;
+const size_t ARCHIVE_GAME_HEADER_SIZE = 4;
+const size_t ARCHIVE_MAX_PLIES        = 0xffff;
+
+enum ArchiveResult
+{
+    ARCHIVE_UNFINISHED = 0,
+    ARCHIVE_WHITE_WINS,
+    ARCHIVE_BLACK_WINS,
+    ARCHIVE_DRAW
+};
+
+// Index of a move among the position's legal moves in archive order,
+//  -1 if it isn't legal. list holds the legal moves, as GenLegalMoveList()
+//  leaves them
+int ArchiveMoveIndex(const MOVELIST &list, Move move);
+
+// The legal move with an index in archive order, false if there are fewer
+//  legal moves
+bool ArchiveMoveAt(const MOVELIST &list, int index, Move &move);
+
+// Writes games to an archive file
+class ArchiveWriter
+{
+  public:
+    ArchiveWriter() : file(NULL), games(0), failed(false) {}
+    ~ArchiveWriter() { Close(); }
+
+    // Create the file, false if it can't be
+    bool Open(const char *path);
+
+    // Append a game, moves holds its archive indices. False if the game is
+    //  too long or writing fails
+    bool Write(const uint8_t *moves, size_t plies, ArchiveResult result);
+
+    // Fill in the game count and close, false if anything failed to write
+    bool Close();
+
+    uint64_t Games() const { return games; }
+
+  private:
+    FILE *file;
+    uint64_t games;
+    bool failed;
+};
+
+// A game as it lies in the archive
+struct ArchiveGame
+{
+    ArchiveResult result;
+    size_t plies;
+    const uint8_t *moves; // archive indices, a byte a ply
+};
+
+// Reads the games of an archive in memory, such as a mapped file
+class ArchiveReader
+{
+  public:
+    ArchiveReader() : begin(NULL), end(NULL), games(0) {}
+
+    // False if data isn't an archive this version can read
+    bool Open(const void *data, size_t size);
+
+    // Game count from the header, 0 if the archive wasn't closed
+    uint64_t Games() const { return games; }
+
+    // Cut the games into at most n runs of about the same size for threads
+    //  to read separately, returned as the n + 1 ends of the runs. Only the
+    //  game headers are read
+    std::vector<const uint8_t *> Split(size_t n) const;
+
+    // The game starting offset bytes into the archive, false if there
+    //  isn't one. Offsets of games are what position indexes refer to them
+    //  by, see posindex.h
+    bool GameAt(uint64_t offset, ArchiveGame &game) const;
+
+    // Next game in the run [p, run_end), false at its end or at a game cut
+    //  short by the end of the file
+    static bool Next(
+        const uint8_t *&p, const uint8_t *run_end, ArchiveGame &game);
+
+    // Play a game from the standard position, false if an index has no
+    //  legal move. position is left after the last good move
+    static bool Replay(const ArchiveGame &game, ChessRules &position);
+
+  private:
+    const uint8_t *begin; // first game
+    const uint8_t *end;
+    uint64_t games;
+};
+
+} // namespace thc
+
+#endif // THC_ARCHIVE_H
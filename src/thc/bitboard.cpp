@@ -0,0 +1,237 @@
+/****************************************************************************
+ * bitboard.cpp Bitboard attack tables for thc
+ *  Tables are built once at runtime. Magic numbers are found by a seeded
+ *  (so deterministic) search, which takes a few milliseconds.
+ ****************************************************************************/
+
+#include "bitboard.h"
+
+#include <string.h>
+
+namespace thc
+{
+
+// clang-format off
+const signed char bitboard_index[128] =
+{
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+//      A        B         C  D  E  F  G  H  I  J  K        L  M  N          O
+    -1,-1,BB_BISHOP,-1,-1,-1,-1,-1,-1,-1,-1,BB_KING,-1,-1,BB_KNIGHT,-1,
+//  P        Q         R
+    BB_PAWN,BB_QUEEN,BB_ROOK,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+//      a  b                   c  d  e  f  g  h  i  j  k                  l  m  n                    o
+    -1,-1,BB_BLACK+BB_BISHOP,-1,-1,-1,-1,-1,-1,-1,-1,BB_BLACK+BB_KING,-1,-1,BB_BLACK+BB_KNIGHT,-1,
+//  p                 q                  r
+    BB_BLACK+BB_PAWN,BB_BLACK+BB_QUEEN,BB_BLACK+BB_ROOK,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+};
+// clang-format on
+
+Bitboard knight_attacks[64];
+Bitboard king_attacks[64];
+Bitboard pawn_attacks[2][64];
+Bitboard between_squares[64][64];
+Bitboard line_through[64][64];
+
+Magic bishop_magics[64];
+Magic rook_magics[64];
+
+static Bitboard bishop_table[5248];
+static Bitboard rook_table[102400];
+
+// (file, row) steps, row 0 is rank 8
+static const int bishop_dirs[4][2] = {{-1, -1}, {1, -1}, {-1, 1}, {1, 1}};
+static const int rook_dirs[4][2]   = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+static bool on_board(int file, int row)
+{
+    return 0 <= file && file < 8 && 0 <= row && row < 8;
+}
+
+static Bitboard square_bit(int file, int row)
+{
+    return (Bitboard)1 << (row * 8 + file);
+}
+
+// Attacks along rays, stopping at (and including) the first occupied square
+static Bitboard slide(int square, const int dirs[4][2], Bitboard occupied)
+{
+    Bitboard attacks = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        int file = (square & 7) + dirs[d][0];
+        int row  = (square >> 3) + dirs[d][1];
+        for (; on_board(file, row); file += dirs[d][0], row += dirs[d][1])
+        {
+            Bitboard b = square_bit(file, row);
+            attacks |= b;
+            if (occupied & b)
+                break;
+        }
+    }
+    return attacks;
+}
+
+// Squares whose occupancy matters to a slider, the last square of each ray
+//  never blocks anything beyond it so is left out
+static Bitboard relevant_mask(int square, const int dirs[4][2])
+{
+    Bitboard mask = 0;
+    for (int d = 0; d < 4; d++)
+    {
+        int file = (square & 7) + dirs[d][0];
+        int row  = (square >> 3) + dirs[d][1];
+        for (; on_board(file + dirs[d][0], row + dirs[d][1]);
+             file += dirs[d][0], row += dirs[d][1])
+            mask |= square_bit(file, row);
+    }
+    return mask;
+}
+
+#if !defined(__BMI2__)
+static uint64_t rand64(uint64_t &state)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+}
+#endif
+
+static void init_magics(Magic magics[64], Bitboard *table, const int dirs[4][2])
+{
+    static Bitboard occupancy[4096], reference[4096];
+    static int epoch[4096];
+    int attempt = 0;
+    Bitboard *attacks = table;
+
+    for (int square = 0; square < 64; square++)
+    {
+        Magic &m  = magics[square];
+        m.mask    = relevant_mask(square, dirs);
+        m.shift   = 64 - BitboardCount(m.mask);
+        m.attacks = attacks;
+        m.magic   = 0;
+
+        // Enumerate all subsets of the mask (Carry-Rippler)
+        int size   = 0;
+        Bitboard b = 0;
+        do
+        {
+            occupancy[size] = b;
+            reference[size] = slide(square, dirs, b);
+            size++;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+
+#if defined(__BMI2__)
+        for (int i = 0; i < size; i++)
+            m.attacks[m.Index(occupancy[i])] = reference[i];
+#else
+        // Try sparse random numbers until one maps every occupancy to an
+        //  index without a destructive collision
+        uint64_t seed = 0x9e3779b97f4a7c15ULL ^ (uint64_t)(square + 1);
+        for (bool found = false; !found;)
+        {
+            m.magic = rand64(seed) & rand64(seed) & rand64(seed);
+            if (BitboardCount((m.mask * m.magic) >> 56) < 6)
+                continue;
+            attempt++;
+            found = true;
+            for (int i = 0; found && i < size; i++)
+            {
+                unsigned idx = m.Index(occupancy[i]);
+                if (epoch[idx] < attempt)
+                {
+                    epoch[idx]     = attempt;
+                    m.attacks[idx] = reference[i];
+                }
+                else if (m.attacks[idx] != reference[i])
+                    found = false;
+            }
+        }
+#endif
+        attacks += size;
+    }
+}
+
+static bool init_tables()
+{
+    for (int square = 0; square < 64; square++)
+    {
+        int file = square & 7, row = square >> 3;
+        static const int knight_steps[8][2] = {
+            {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+        knight_attacks[square] = 0;
+        king_attacks[square]   = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            if (on_board(file + knight_steps[i][0], row + knight_steps[i][1]))
+                knight_attacks[square] |= square_bit(
+                    file + knight_steps[i][0], row + knight_steps[i][1]);
+        }
+        for (int df = -1; df <= 1; df++)
+        {
+            for (int dr = -1; dr <= 1; dr++)
+            {
+                if ((df || dr) && on_board(file + df, row + dr))
+                    king_attacks[square] |= square_bit(file + df, row + dr);
+            }
+        }
+
+        // White pawns capture north (towards row 0), black pawns south
+        pawn_attacks[0][square] = 0;
+        pawn_attacks[1][square] = 0;
+        for (int df = -1; df <= 1; df += 2)
+        {
+            if (on_board(file + df, row - 1))
+                pawn_attacks[0][square] |= square_bit(file + df, row - 1);
+            if (on_board(file + df, row + 1))
+                pawn_attacks[1][square] |= square_bit(file + df, row + 1);
+        }
+    }
+
+    init_magics(bishop_magics, bishop_table, bishop_dirs);
+    init_magics(rook_magics, rook_table, rook_dirs);
+
+    memset(between_squares, 0, sizeof(between_squares));
+    memset(line_through, 0, sizeof(line_through));
+    for (int a = 0; a < 64; a++)
+    {
+        for (int b = 0; b < 64; b++)
+        {
+            if (a == b)
+                continue;
+            Bitboard bit_b = (Bitboard)1 << b;
+            Bitboard bit_a = (Bitboard)1 << a;
+            if (slide(a, bishop_dirs, 0) & bit_b)
+            {
+                line_through[a][b] = (slide(a, bishop_dirs, 0) &
+                                      slide(b, bishop_dirs, 0)) |
+                                     bit_a | bit_b;
+                between_squares[a][b] =
+                    slide(a, bishop_dirs, bit_b) & slide(b, bishop_dirs, bit_a);
+            }
+            else if (slide(a, rook_dirs, 0) & bit_b)
+            {
+                line_through[a][b] =
+                    (slide(a, rook_dirs, 0) & slide(b, rook_dirs, 0)) | bit_a |
+                    bit_b;
+                between_squares[a][b] =
+                    slide(a, rook_dirs, bit_b) & slide(b, rook_dirs, bit_a);
+            }
+        }
+    }
+    return true;
+}
+
+void BitboardInit()
+{
+    // function statics are initialised exactly once, even across threads
+    static bool initialized = init_tables();
+    (void)initialized;
+}
+
+} // namespace thc
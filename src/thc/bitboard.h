@@ -0,0 +1,114 @@
+/****************************************************************************
+ * bitboard.h Bitboard attack tables for thc
+ *  Squares use the thc::Square convention, bit 0 is a8 and bit 63 is h1,
+ *  so moving "north" (towards rank 8) is a right shift by 8.
+ *
+ *  Sliding piece attacks use magic multiplication, or the BMI2 pext
+ *  instruction when the compiler targets it (eg -mbmi2).
+ ****************************************************************************/
+#ifndef THC_BITBOARD_H
+#define THC_BITBOARD_H
+
+#include <stdint.h>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// TripleHappyChess
+namespace thc
+{
+
+typedef uint64_t Bitboard;
+
+// Index of each piece's set in ChessRules::bb_pieces[]
+enum BitboardPiece
+{
+    BB_PAWN = 0,
+    BB_KNIGHT,
+    BB_BISHOP,
+    BB_ROOK,
+    BB_QUEEN,
+    BB_KING,
+    BB_BLACK = 6, // add to a white index for the black piece
+    BB_NBR   = 12
+};
+
+// Convert piece, e.g. 'N' to its BitboardPiece, -1 for empty squares
+extern const signed char bitboard_index[128];
+
+// Fill in the lookup tables, safe to call repeatedly and from any thread
+void BitboardInit();
+
+const Bitboard BB_FILE_A = 0x0101010101010101ULL;
+const Bitboard BB_FILE_H = BB_FILE_A << 7;
+const Bitboard BB_RANK_8 = 0xffULL;
+const Bitboard BB_RANK_6 = BB_RANK_8 << 16;
+const Bitboard BB_RANK_3 = BB_RANK_8 << 40;
+const Bitboard BB_RANK_1 = BB_RANK_8 << 56;
+
+// Squares attacked from a square by a knight, king and pawn. For pawns
+//  the first index is 0 for a white pawn and 1 for a black pawn
+extern Bitboard knight_attacks[64];
+extern Bitboard king_attacks[64];
+extern Bitboard pawn_attacks[2][64];
+
+// Squares strictly between two squares on a line, 0 if not on a line
+extern Bitboard between_squares[64][64];
+
+// The whole line (edge to edge) through two squares, 0 if not on a line
+extern Bitboard line_through[64][64];
+
+// Sliding attack lookup for one square
+struct Magic
+{
+    Bitboard mask;  // relevant occupancy, board edges excluded
+    Bitboard magic;
+    Bitboard *attacks;
+    unsigned shift;
+
+    unsigned Index(Bitboard occupied) const
+    {
+#if defined(__BMI2__)
+        return (unsigned)_pext_u64(occupied, mask);
+#else
+        return (unsigned)(((occupied & mask) * magic) >> shift);
+#endif
+    }
+};
+
+extern Magic bishop_magics[64];
+extern Magic rook_magics[64];
+
+inline Bitboard BishopAttacks(int square, Bitboard occupied)
+{
+    const Magic &m = bishop_magics[square];
+    return m.attacks[m.Index(occupied)];
+}
+
+inline Bitboard RookAttacks(int square, Bitboard occupied)
+{
+    const Magic &m = rook_magics[square];
+    return m.attacks[m.Index(occupied)];
+}
+
+inline Bitboard QueenAttacks(int square, Bitboard occupied)
+{
+    return BishopAttacks(square, occupied) | RookAttacks(square, occupied);
+}
+
+inline int BitboardCount(Bitboard b) { return __builtin_popcountll(b); }
+
+inline int BitboardLsb(Bitboard b) { return __builtin_ctzll(b); }
+
+// Remove and return the lowest square in a set
+inline int BitboardPopLsb(Bitboard &b)
+{
+    int square = __builtin_ctzll(b);
+    b &= b - 1;
+    return square;
+}
+
+} // namespace thc
+
+#endif // THC_BITBOARD_H
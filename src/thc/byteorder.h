@@ -0,0 +1,54 @@
+/****************************************************************************
+ * byteorder.h Little endian numbers in thc's file formats
+ *  Packed and unpacked a byte at a time, so files read the same whatever
+ *  the host's byte order and alignment.
+ ****************************************************************************/
+#ifndef THC_BYTEORDER_H
+#define THC_BYTEORDER_H
+
+#include <stdint.h>
+
+// TripleHappyChess
+namespace thc
+{
+
+inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline void put32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+inline void put64(uint8_t *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline uint64_t get64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++)
+        v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+} // namespace thc
+
+#endif // THC_BYTEORDER_H
@@ -0,0 +1,48 @@
+/****************************************************************************
+ * mapped.cpp A whole file mapped read only
+ ****************************************************************************/
+
+#include "mapped.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace thc
+{
+
+bool MappedFile::Open(const char *path, MappedAccess access)
+{
+    Close();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size > 0)
+    {
+        void *mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok           = mapped != MAP_FAILED;
+        if (ok)
+        {
+            madvise(mapped, st.st_size,
+                access == MAPPED_RANDOM ? MADV_RANDOM : MADV_SEQUENTIAL);
+            data = (const char *)mapped;
+            size = st.st_size;
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+void MappedFile::Close()
+{
+    if (data)
+        munmap((void *)data, size);
+    data = NULL;
+    size = 0;
+}
+
+} // namespace thc
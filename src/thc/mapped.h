@@ -0,0 +1,45 @@
+/****************************************************************************
+ * mapped.h A whole file mapped read only, for thc's file formats
+ *  PGN, archives and position indexes are read straight out of the
+ *  mapping, so a file of any size is never copied into memory.
+ ****************************************************************************/
+#ifndef THC_MAPPED_H
+#define THC_MAPPED_H
+
+#include <stddef.h>
+
+// TripleHappyChess
+namespace thc
+{
+
+// How the file will be read, for the kernel's read ahead
+enum MappedAccess
+{
+    MAPPED_SEQUENTIAL = 0, // front to back
+    MAPPED_RANDOM          // a few pages at a time, all over the file
+};
+
+class MappedFile
+{
+  public:
+    MappedFile() : data(NULL), size(0) {}
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // False if the file can't be opened or mapped, an empty file is fine
+    bool Open(const char *path, MappedAccess access = MAPPED_SEQUENTIAL);
+    void Close();
+
+    const char *Begin() const { return data; }
+    const char *End() const { return data + size; }
+    size_t Size() const { return size; }
+
+  private:
+    const char *data;
+    size_t size;
+};
+
+} // namespace thc
+
+#endif // THC_MAPPED_H
@@ -0,0 +1,418 @@
+/****************************************************************************
+ * posindex.cpp Position index for thc
+ *  The builder is an external merge sort. Positions are held until memory
+ *  is full, sorted by key then game and written to an unnamed temporary
+ *  file, a run. Closing merges the runs, a position's records arriving
+ *  together, so each is written with its totals as soon as the next
+ *  position starts.
+ ****************************************************************************/
+
+#include "posindex.h"
+#include "byteorder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <queue>
+#include <string>
+
+#include <unistd.h>
+
+namespace thc
+{
+
+static const char posindex_magic[4] = {'C', '2', 'P', 'I'};
+
+// Runs merged at once. A level with this many runs is merged into one run
+//  on the next level, so there are few runs open for any size of index
+static const size_t MAX_MERGE_RUNS = 64;
+
+// Records read from a run at a time while merging
+static const size_t RUN_BUFFER_RECORDS = 8192;
+
+static const size_t KEY_SIZE = sizeof(CompressedPosition);
+
+static bool write_header(FILE *file, uint64_t positions, uint64_t ids)
+{
+    uint8_t header[POSINDEX_HEADER_SIZE] = {};
+    memcpy(header, posindex_magic, 4);
+    put16(header + 4, POSINDEX_VERSION);
+    put64(header + 16, positions);
+    put64(header + 24, ids);
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+// A temporary file in $TMPDIR, or /tmp, gone once closed
+static FILE *temp_file()
+{
+    const char *dir = getenv("TMPDIR");
+    std::string path(dir && *dir ? dir : "/tmp");
+    path += "/posindexXXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0)
+        return NULL;
+    unlink(path.c_str());
+    FILE *file = fdopen(fd, "w+b");
+    if (file == NULL)
+        close(fd);
+    return file;
+}
+
+/****************************************************************************
+ * Builder
+ ****************************************************************************/
+
+PositionIndexBuilder::PositionIndexBuilder()
+    : memory(0), file(NULL), ids(NULL), failed(false), pending(false),
+      positions(0), idCount(0)
+{
+}
+
+PositionIndexBuilder::~PositionIndexBuilder()
+{
+    // An index that wasn't closed is incomplete, leave it unreadable
+    Discard();
+}
+
+bool PositionIndexBuilder::Less(const Record &a, const Record &b)
+{
+    int c = memcmp(a.key.storage, b.key.storage, KEY_SIZE);
+    return c < 0 || (c == 0 && a.game < b.game);
+}
+
+bool PositionIndexBuilder::Open(const char *path, size_t memory)
+{
+    Discard();
+    this->memory = std::max(memory, sizeof(Record));
+    failed       = false;
+    pending      = false;
+    positions    = 0;
+    idCount      = 0;
+    file         = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+
+    // A header with no positions until the rest is written
+    failed = !write_header(file, 0, 0);
+    records.reserve(this->memory / sizeof(Record));
+    return !failed;
+}
+
+bool PositionIndexBuilder::Add(
+    const CompressedPosition &position, uint64_t game, ArchiveResult result)
+{
+    if (file == NULL || failed)
+        return false;
+    Record record;
+    record.key    = position;
+    record.game   = game;
+    record.result = (uint8_t)result;
+    records.push_back(record);
+    if (records.size() * sizeof(Record) >= memory)
+        failed = !WriteRun();
+    return !failed;
+}
+
+bool PositionIndexBuilder::WriteRun()
+{
+    std::sort(records.begin(), records.end(), Less);
+    FILE *run = temp_file();
+    if (run == NULL)
+        return false;
+    if (levels.empty())
+        levels.resize(1);
+    levels[0].push_back(run);
+    bool ok = fwrite(records.data(), sizeof(Record), records.size(), run) ==
+              records.size();
+    records.clear();
+
+    for (size_t level = 0; ok && levels[level].size() == MAX_MERGE_RUNS;
+         level++)
+    {
+        FILE *merged = temp_file();
+        if (merged == NULL)
+            return false;
+        if (level + 1 == levels.size())
+            levels.resize(level + 2);
+        levels[level + 1].push_back(merged);
+        ok = Merge(levels[level], merged);
+    }
+    return ok;
+}
+
+// Merge sorted runs, dropping repeats of a position in a game. The result
+//  is another run if into is set, otherwise the index itself
+bool PositionIndexBuilder::Merge(std::vector<FILE *> &from, FILE *into)
+{
+    struct RunReader
+    {
+        FILE *file;
+        std::vector<Record> buffer;
+        size_t next;
+        size_t count;
+
+        bool Refill()
+        {
+            next  = 0;
+            count = fread(buffer.data(), sizeof(Record), buffer.size(), file);
+            return count > 0;
+        }
+    };
+
+    std::vector<RunReader> readers(from.size());
+    bool ok = true;
+    for (size_t i = 0; i < from.size(); i++)
+    {
+        readers[i].file = from[i];
+        readers[i].buffer.resize(RUN_BUFFER_RECORDS);
+        ok = ok && fflush(from[i]) == 0 && fseek(from[i], 0, SEEK_SET) == 0;
+    }
+
+    // Heap of the readers by their next record, smallest on top
+    auto later = [&](size_t a, size_t b) {
+        return Less(readers[b].buffer[readers[b].next],
+            readers[a].buffer[readers[a].next]);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(
+        later);
+    for (size_t i = 0; ok && i < readers.size(); i++)
+    {
+        if (readers[i].Refill())
+            heap.push(i);
+    }
+
+    Record last;
+    bool any = false;
+    while (ok && !failed && !heap.empty())
+    {
+        size_t i = heap.top();
+        heap.pop();
+        RunReader &reader = readers[i];
+        Record record     = reader.buffer[reader.next++];
+
+        bool repeat = any && last.game == record.game &&
+                      memcmp(last.key.storage, record.key.storage, KEY_SIZE) ==
+                          0;
+        if (!repeat)
+        {
+            if (into)
+                ok = fwrite(&record, sizeof(Record), 1, into) == 1;
+            else
+                Emit(record);
+        }
+        last = record;
+        any  = true;
+
+        if (reader.next < reader.count || reader.Refill())
+            heap.push(i);
+    }
+
+    for (FILE *run : from)
+    {
+        ok = ok && !ferror(run);
+        ok = fclose(run) == 0 && ok;
+    }
+    from.clear();
+    return ok && !failed;
+}
+
+// Add a record to the position being written, starting the next position
+//  if it is a new one
+void PositionIndexBuilder::Emit(const Record &record)
+{
+    if (!pending || memcmp(current.key.storage, record.key.storage,
+                        KEY_SIZE) != 0)
+    {
+        if (pending)
+            EndPosition();
+        pending = true;
+        current = record;
+        stats   = PositionStats();
+    }
+
+    stats.games++;
+    switch (record.result)
+    {
+    case ARCHIVE_WHITE_WINS: stats.whiteWins++; break;
+    case ARCHIVE_BLACK_WINS: stats.blackWins++; break;
+    case ARCHIVE_DRAW: stats.draws++; break;
+    default: break;
+    }
+
+    uint8_t id[8];
+    put64(id, record.game);
+    if (fwrite(id, 1, sizeof(id), ids) != sizeof(id))
+        failed = true;
+    idCount++;
+}
+
+void PositionIndexBuilder::EndPosition()
+{
+    uint8_t entry[POSINDEX_POSITION_SIZE];
+    memcpy(entry, current.key.storage, KEY_SIZE);
+    put64(entry + 24, idCount - stats.games);
+    put32(entry + 32, stats.games);
+    put32(entry + 36, stats.whiteWins);
+    put32(entry + 40, stats.blackWins);
+    put32(entry + 44, stats.draws);
+    if (fwrite(entry, 1, sizeof(entry), file) != sizeof(entry))
+        failed = true;
+    positions++;
+    pending = false;
+}
+
+bool PositionIndexBuilder::Close()
+{
+    if (file == NULL)
+        return !failed;
+
+    if (!failed && !records.empty())
+        failed = !WriteRun();
+    std::vector<Record>().swap(records);
+
+    // The runs left on every level are merged at once. The positions go
+    //  straight into the index, their game ids to a temporary file that is
+    //  copied in after them
+    std::vector<FILE *> runs;
+    for (std::vector<FILE *> &level : levels)
+    {
+        runs.insert(runs.end(), level.begin(), level.end());
+        level.clear();
+    }
+    if (!failed)
+    {
+        ids    = temp_file();
+        failed = ids == NULL || !Merge(runs, NULL);
+        if (!failed && pending)
+            EndPosition();
+    }
+    if (!failed)
+    {
+        std::vector<uint8_t> buffer(1024 * 1024);
+        size_t n;
+        failed = fflush(ids) != 0 || fseek(ids, 0, SEEK_SET) != 0;
+        while (!failed && (n = fread(buffer.data(), 1, buffer.size(), ids)))
+            failed = fwrite(buffer.data(), 1, n, file) != n;
+        failed = failed || ferror(ids);
+    }
+    if (!failed)
+    {
+        failed = fseek(file, 0, SEEK_SET) != 0 ||
+                 !write_header(file, positions, idCount);
+    }
+
+    for (FILE *run : runs)
+        fclose(run);
+    if (fclose(file) != 0)
+        failed = true;
+    file = NULL;
+    Discard();
+    return !failed;
+}
+
+// Drop the temporary files, and an index that wasn't closed
+void PositionIndexBuilder::Discard()
+{
+    for (std::vector<FILE *> &level : levels)
+    {
+        for (FILE *run : level)
+            fclose(run);
+    }
+    levels.clear();
+    records.clear();
+    if (ids)
+        fclose(ids);
+    ids = NULL;
+    if (file)
+    {
+        // Without a header the file can't be mistaken for an index
+        fseek(file, 0, SEEK_SET);
+        fwrite("\0\0\0\0", 1, 4, file);
+        fclose(file);
+        file   = NULL;
+        failed = true;
+    }
+}
+
+/****************************************************************************
+ * Lookups
+ ****************************************************************************/
+
+bool PositionIndex::Open(const char *path)
+{
+    Close();
+
+    // Lookups touch a few pages each, all over the file
+    if (!file.Open(path, MAPPED_RANDOM) || file.Size() < POSINDEX_HEADER_SIZE)
+    {
+        Close();
+        return false;
+    }
+    data = (const uint8_t *)file.Begin();
+
+    positions = get64(data + 16);
+    idCount   = get64(data + 24);
+    uint64_t body = file.Size() - POSINDEX_HEADER_SIZE;
+    bool ok = memcmp(data, posindex_magic, 4) == 0 &&
+              get16(data + 4) == POSINDEX_VERSION &&
+              positions <= body / POSINDEX_POSITION_SIZE &&
+              idCount == (body - positions * POSINDEX_POSITION_SIZE) / 8 &&
+              body == positions * POSINDEX_POSITION_SIZE + idCount * 8;
+    if (!ok)
+        Close();
+    return ok;
+}
+
+void PositionIndex::Close()
+{
+    file.Close();
+    data      = NULL;
+    positions = 0;
+    idCount   = 0;
+}
+
+bool PositionIndex::Find(
+    const CompressedPosition &position, PositionStats &stats,
+    uint64_t &first) const
+{
+    const uint8_t *base = data + POSINDEX_HEADER_SIZE;
+    uint64_t lo = 0, hi = positions;
+    while (lo < hi)
+    {
+        uint64_t mid         = lo + (hi - lo) / 2;
+        const uint8_t *entry = base + mid * POSINDEX_POSITION_SIZE;
+        int c                = memcmp(entry, position.storage, KEY_SIZE);
+        if (c < 0)
+            lo = mid + 1;
+        else if (c > 0)
+            hi = mid;
+        else
+        {
+            first           = get64(entry + 24);
+            stats.games     = get32(entry + 32);
+            stats.whiteWins = get32(entry + 36);
+            stats.blackWins = get32(entry + 40);
+            stats.draws     = get32(entry + 44);
+            return first + stats.games <= idCount;
+        }
+    }
+    return false;
+}
+
+bool PositionIndex::Find(
+    const ChessPosition &position, PositionStats &stats, uint64_t &first) const
+{
+    CompressedPosition key;
+    position.Compress(key);
+    return Find(key, stats, first);
+}
+
+uint64_t PositionIndex::Game(uint64_t first, uint32_t i) const
+{
+    const uint8_t *ids =
+        data + POSINDEX_HEADER_SIZE + positions * POSINDEX_POSITION_SIZE;
+    return get64(ids + (first + i) * 8);
+}
+
+} // namespace thc
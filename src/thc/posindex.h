@@ -0,0 +1,140 @@
+/****************************************************************************
+ * posindex.h Position index for thc, the games reaching a position
+ *  A file of positions sorted by their 24 byte CompressedPosition, each
+ *  with result counts and the ids of the games that reached it. Lookups
+ *  binary search the mapped file, so an index of hundreds of millions of
+ *  positions is never read into memory. The builder sorts in runs of
+ *  bounded size on temporary files and merges them.
+ *
+ *  Index header     "C2PI", uint16 version, uint16 0, uint32 0,
+ *                   uint64 position count, uint64 game id count
+ *  Positions        48 bytes each, sorted by key
+ *                   uint8 key[24], uint64 first game id, uint32 games,
+ *                   uint32 white wins, uint32 black wins, uint32 draws
+ *  Game ids         uint64 each, a position's ids ascending
+ *
+ *  Numbers are little endian. A position reached more than once in a game
+ *  counts the game once. Game ids are whatever the builder was given,
+ *  posindex.out uses each game's offset in its archive (see archive.h).
+ ****************************************************************************/
+#ifndef THC_POSINDEX_H
+#define THC_POSINDEX_H
+
+#include "archive.h"
+#include "mapped.h"
+#include "thc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+// TripleHappyChess
+namespace thc
+{
+
+const uint16_t POSINDEX_VERSION      = 1;
+const size_t POSINDEX_HEADER_SIZE    = 32;
+const size_t POSINDEX_POSITION_SIZE  = 48;
+const size_t POSINDEX_DEFAULT_MEMORY = 256 * 1024 * 1024;
+
+// Games reaching a position
+struct PositionStats
+{
+    uint32_t games; // including unfinished games
+    uint32_t whiteWins;
+    uint32_t blackWins;
+    uint32_t draws;
+};
+
+// Builds an index file from the positions of games
+class PositionIndexBuilder
+{
+  public:
+    PositionIndexBuilder();
+    ~PositionIndexBuilder();
+    PositionIndexBuilder(const PositionIndexBuilder &)            = delete;
+    PositionIndexBuilder &operator=(const PositionIndexBuilder &) = delete;
+
+    // Create the file, false if it can't be. memory bounds the positions
+    //  held before a run is sorted and set aside on a temporary file
+    bool Open(const char *path, size_t memory = POSINDEX_DEFAULT_MEMORY);
+
+    // A position reached by a game, with the game's id and result
+    bool Add(
+        const CompressedPosition &position, uint64_t game,
+        ArchiveResult result);
+
+    // Merge the runs into the index and close it, false if anything failed
+    bool Close();
+
+    // Distinct positions written, once closed
+    uint64_t Positions() const { return positions; }
+
+  private:
+    struct Record
+    {
+        CompressedPosition key;
+        uint64_t game;
+        uint8_t result; // ArchiveResult
+    };
+
+    static bool Less(const Record &a, const Record &b);
+    bool WriteRun();
+    bool Merge(std::vector<FILE *> &from, FILE *into);
+    void Emit(const Record &record);
+    void EndPosition();
+    void Discard();
+
+    size_t memory;
+    FILE *file;
+    FILE *ids; // game ids, copied after the positions once all are written
+    bool failed;
+    std::vector<Record> records; // sorted into a run once memory is full
+    std::vector<std::vector<FILE *>> levels; // runs, merged in batches
+
+    // The position being written as the runs are merged
+    bool pending;
+    Record current;
+    PositionStats stats;
+    uint64_t positions;
+    uint64_t idCount;
+};
+
+// Looks up positions in a mapped index file
+class PositionIndex
+{
+  public:
+    PositionIndex() : data(NULL), positions(0), idCount(0) {}
+    ~PositionIndex() { Close(); }
+    PositionIndex(const PositionIndex &)            = delete;
+    PositionIndex &operator=(const PositionIndex &) = delete;
+
+    // Map the file, false if it isn't an index this version can read
+    bool Open(const char *path);
+    void Close();
+
+    uint64_t Positions() const { return positions; }
+
+    // Binary search for a position, false if no game reached it. first is
+    //  where its game ids start, for Game()
+    bool Find(
+        const CompressedPosition &position, PositionStats &stats,
+        uint64_t &first) const;
+    bool Find(
+        const ChessPosition &position, PositionStats &stats,
+        uint64_t &first) const;
+
+    // Game id i of those Find() returned from first, i below stats.games
+    uint64_t Game(uint64_t first, uint32_t i) const;
+
+  private:
+    MappedFile file;
+    const uint8_t *data; // the file's bytes
+    uint64_t positions;
+    uint64_t idCount;
+};
+
+} // namespace thc
+
+#endif // THC_POSINDEX_H
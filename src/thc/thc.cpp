@@ -30,6 +30,9 @@
 #include <assert.h>
 #include <algorithm>
 #include "thc.h"
+#ifdef THC_BITBOARDS
+#include "bitboard.h"
+#endif
 using namespace std;
 using namespace thc;
 /****************************************************************************
@@ -100,6 +103,9 @@ inline Square& operator++ ( Square& sq )
 #define NW(sq)      (  (Square)((sq) - 9) )                     // eg c5->b6
 #define NE(sq)      (  (Square)((sq) - 7) )                     // eg c5->d6
 
+// Bit mask for a square, Square convention a8=bit 0 etc.
+#define SQUARE_BIT(sq) ( ((uint64_t)1) << (int)(sq) )
+
 // Utility macro
 #ifndef nbrof
     #define nbrof(array) (sizeof((array))/sizeof((array)[0]))
@@ -843,6 +849,19 @@ static uint64_t hash64_lookup[64]['r'-'B'+1] =
     }
 };
 
+// The parts of a position Hash64Calculate() leaves out, combined with it
+//  to make ChessRules::Hash64Key()
+static const uint64_t hash64_black_to_move = 0xea08c9a3892a0807;
+static const uint64_t hash64_castling[4] =  // wking, wqueen, bking, bqueen
+{
+    0x44fc639af2da29f8, 0xd99d759bcb1b1605, 0xe7e89e7b81f0d171, 0x0164a0ce0b7541cc
+};
+static const uint64_t hash64_enpassant_file[8] =
+{
+    0x4821ed319b445611, 0x6b8f7db8850ac3f2, 0x85ad440470d0195c, 0xd9032fe209af44ef,
+    0xef3288ec2ad92c89, 0x43851e67e8f8207b, 0xf51f0af74ca74fe2, 0x40af0ff27a1b9e6c
+};
+
 
 /****************************************************************************
  * ChessPosition.cpp Chess classes - Representation of the position on the board
@@ -1220,11 +1239,24 @@ bool ChessPosition::Forsyth( const char *txt )
  * Publish chess position and supplementary info in forsyth notation
  ****************************************************************************/
 std::string ChessPosition::ForsythPublish()
+{
+    char fen[MAXFORSYTH];
+    ForsythPublish( fen, sizeof(fen) );
+    return fen;
+}
+
+/****************************************************************************
+ * Publish chess position and supplementary info in forsyth notation into a
+ *  caller's buffer
+ *  return length, or 0 if n is too small
+ ****************************************************************************/
+size_t ChessPosition::ForsythPublish( char *fen, size_t n )
 {
     int i, empty=0, file=0, rank=7, save_file=0, save_rank=0;
     Square sq;
     char p;
-    std::string str;
+    char str[MAXFORSYTH];
+    char *s = str;
 
     // Squares
     for( i=0; i<64; i++ )
@@ -1242,22 +1274,18 @@ std::string ChessPosition::ForsythPublish()
         {
             if( empty )
             {
-                char count = '0' + (char)empty;
-                str += count;
+                *s++ = '0' + (char)empty;
                 empty = 0;
             }
-            str += p;
+            *s++ = p;
         }
         file++;
         if( file == 8 )
         {
             if( empty )
-            {
-                char count = '0'+(char)empty;
-                str += count;
-            }
+                *s++ = '0' + (char)empty;
             if( rank )
-                str += '/';
+                *s++ = '/';
             empty = 0;
             file = 0;
             rank--;
@@ -1265,42 +1293,47 @@ std::string ChessPosition::ForsythPublish()
     }
 
     // Who to move
-    str += ' ';
-    str += (white?'w':'b');
+    *s++ = ' ';
+    *s++ = (white?'w':'b');
 
     // Castling flags
-    str += ' ';
+    *s++ = ' ';
     if( !wking_allowed() && !wqueen_allowed() && !bking_allowed() && !bqueen_allowed() )
-        str += '-';
+        *s++ = '-';
     else
     {
         if( wking_allowed() )
-            str += 'K';
+            *s++ = 'K';
         if( wqueen_allowed() )
-            str += 'Q';
+            *s++ = 'Q';
         if( bking_allowed() )
-            str += 'k';
+            *s++ = 'k';
         if( bqueen_allowed() )
-            str += 'q';
+            *s++ = 'q';
     }
 
     // Enpassant target square
-    str += ' ';
+    *s++ = ' ';
     if( enpassant_target==SQUARE_INVALID || save_rank==0 )
-        str += '-';
+        *s++ = '-';
     else
     {
-        char file2 = 'a'+(char)save_file;
-        str += file2;
-        char rank2 = '1'+(char)save_rank;
-        str += rank2;
+        *s++ = 'a'+(char)save_file;
+        *s++ = '1'+(char)save_rank;
     }
 
     // Counts
-    char buf[40];
-    sprintf( buf, " %d %d", half_move_clock, full_move_count );
-    str += buf;
-    return( str );
+    s += sprintf( s, " %d %d", half_move_clock, full_move_count );
+
+    size_t len = s - str;
+    if( len >= n )
+    {
+        if( n )
+            *fen = '\0';
+        return 0;
+    }
+    memcpy( fen, str, len+1 );
+    return len;
 }
 
 
@@ -2353,22 +2386,182 @@ void ChessRules::GenLegalMoveList( MOVELIST *list )
     int i, j;
     bool okay;
     MOVELIST list2;
+    uint64_t pinned;
+    uint64_t pin_rays[64];
 
     // Generate all moves, including illegal (e.g. put king in check) moves
     GenMoveList( &list2 );
 
+    // Find checks and pins once, rather than testing every move
+    uint64_t check_mask = GenCheckAndPinMasks( pinned, pin_rays );
+
     // Loop copying the proven good ones
     for( i=j=0; i<list2.count; i++ )
     {
-        PushMove( list2.moves[i] );
-        okay = Evaluate();
-        PopMove( list2.moves[i] );
+        Move &m = list2.moves[i];
+        switch( m.special )
+        {
+            // A king move is legal if its destination isn't attacked, with
+            //  the king lifted off the board so it can't shelter a square
+            //  on a checking slider's line behind itself
+            case SPECIAL_KING_MOVE:
+            {
+                char king = squares[m.src];
+                squares[m.src] = ' ';
+#ifdef THC_BITBOARDS
+                bb_colours[white?0:1] ^= SQUARE_BIT(m.src);
+#endif
+                okay = !AttackedSquare( m.dst, !white );
+#ifdef THC_BITBOARDS
+                bb_colours[white?0:1] ^= SQUARE_BIT(m.src);
+#endif
+                squares[m.src] = king;
+                break;
+            }
+
+            // Enpassant removes two men from a line, so can expose the king
+            //  in ways the masks don't capture, prove it the slow way
+            case SPECIAL_WEN_PASSANT:
+            case SPECIAL_BEN_PASSANT:
+            {
+                PushMove( m );
+                okay = Evaluate();
+                PopMove( m );
+                break;
+            }
+
+            // Castling is fully checked for attacked squares by KingMoves()
+            case SPECIAL_WK_CASTLING:
+            case SPECIAL_BK_CASTLING:
+            case SPECIAL_WQ_CASTLING:
+            case SPECIAL_BQ_CASTLING:
+            {
+                okay = true;
+                break;
+            }
+
+            // Otherwise the move must resolve any check, and a pinned
+            //  piece must stay on the line of its pin
+            default:
+            {
+                uint64_t dst = SQUARE_BIT(m.dst);
+                okay = (check_mask & dst) != 0;
+                if( okay && (pinned & SQUARE_BIT(m.src)) )
+                    okay = (pin_rays[m.src] & dst) != 0;
+                break;
+            }
+        }
         if( okay )
-            list->moves[j++] = list2.moves[i];
+            list->moves[j++] = m;
     }
     list->count  = j;
 }
 
+#ifndef THC_BITBOARDS
+/****************************************************************************
+ * Find the pieces checking the king of the side to move, and our pieces
+ *  pinned against it. Returns a mask of squares a non-king move must land
+ *  on (all squares if not in check, none if in double check). For each
+ *  pinned piece pin_rays[] gives the squares it may move to (the line from
+ *  the king through the pinning piece)
+ ****************************************************************************/
+uint64_t ChessRules::GenCheckAndPinMasks( uint64_t &pinned, uint64_t pin_rays[64] )
+{
+    static const int deltas[8][2] =
+    {
+        { 0,-1}, { 0, 1}, {-1, 0}, { 1, 0},     // orthogonal (file,row)
+        {-1,-1}, { 1,-1}, {-1, 1}, { 1, 1}      // diagonal
+    };
+    Square king = (Square)(white ? wking_square : bking_square);
+    int king_file = IFILE(king);
+    int king_row  = (int)king >> 3;     // a8=row 0
+    int checkers  = 0;
+    uint64_t check_mask = 0;
+    pinned = 0;
+
+    // Sliding checks and pins, look along each ray out from the king
+    for( int dir=0; dir<8; dir++ )
+    {
+        bool diagonal = (dir >= 4);
+        char enemy_slider = diagonal ? (white?'b':'B') : (white?'r':'R');
+        char enemy_queen  = white ? 'q' : 'Q';
+        Square blocker = SQUARE_INVALID;
+        uint64_t ray = 0;
+        int file = king_file + deltas[dir][0];
+        int row  = king_row  + deltas[dir][1];
+        for( ; 0<=file && file<8 && 0<=row && row<8; file+=deltas[dir][0], row+=deltas[dir][1] )
+        {
+            Square sq = (Square)(row*8 + file);
+            char piece = squares[sq];
+            ray |= SQUARE_BIT(sq);
+            if( IsEmptySquare(piece) )
+                continue;
+            if( white ? IsWhite(piece) : IsBlack(piece) )
+            {
+                if( blocker != SQUARE_INVALID )
+                    break;      // two of our men, no pin possible
+                blocker = sq;
+                continue;
+            }
+            if( piece==enemy_slider || piece==enemy_queen )
+            {
+                if( blocker == SQUARE_INVALID )
+                {
+                    checkers++;
+                    check_mask |= ray;
+                }
+                else
+                {
+
+                    // Extend the ray to the board edge so it covers
+                    //  every square on the line of the pin
+                    int f = file + deltas[dir][0];
+                    int r = row  + deltas[dir][1];
+                    for( ; 0<=f && f<8 && 0<=r && r<8; f+=deltas[dir][0], r+=deltas[dir][1] )
+                        ray |= SQUARE_BIT(r*8 + f);
+                    pinned |= SQUARE_BIT(blocker);
+                    pin_rays[blocker] = ray;
+                }
+            }
+            break;
+        }
+    }
+
+    // Knight checks
+    char enemy_knight = white ? 'n' : 'N';
+    const lte *ptr = knight_lookup[king];
+    lte nbr_squares = *ptr++;
+    while( nbr_squares-- )
+    {
+        Square sq = (Square)*ptr++;
+        if( squares[sq] == enemy_knight )
+        {
+            checkers++;
+            check_mask |= SQUARE_BIT(sq);
+        }
+    }
+
+    // Pawn checks, black pawns attack towards the south and vice versa
+    char enemy_pawn = white ? 'p' : 'P';
+    int pawn_row = white ? king_row-1 : king_row+1;
+    if( 0<=pawn_row && pawn_row<8 )
+    {
+        for( int file=king_file-1; file<=king_file+1; file+=2 )
+        {
+            if( 0<=file && file<8 && squares[pawn_row*8+file]==enemy_pawn )
+            {
+                checkers++;
+                check_mask |= SQUARE_BIT(pawn_row*8 + file);
+            }
+        }
+    }
+
+    if( checkers == 0 )
+        return ~(uint64_t)0;
+    return checkers==1 ? check_mask : 0;
+}
+#endif // !THC_BITBOARDS
+
 /****************************************************************************
  * Create a list of all legal moves in this position, with extra info
  ****************************************************************************/
@@ -2438,141 +2631,21 @@ bool ChessRules::IsDraw( bool white_asks, DRAWTYPE &result )
 
 /****************************************************************************
  * Get number of times position has been repeated
+ *  A repeat must have the same side to move and can't be from before the
+ *  last pawn move or capture, so look back two plies at a time through
+ *  the keys saved by PushMove()
  ****************************************************************************/
 int ChessRules::GetRepetitionCount()
 {
-    int matches=0;
-
-    //  Save those aspects of current position that are changed by multiple
-    //  PopMove() calls as we search backwards (i.e. squares, white,
-    //  detail, detail_idx)
-    char save_squares[sizeof(squares)];
-    memcpy( save_squares, squares, sizeof(save_squares) );
-    unsigned char save_detail_idx = detail_idx;  // must be unsigned char
-    bool          save_white      = white;
-    unsigned char idx             = history_idx; // must be unsigned char
-    DETAIL_SAVE;
-
-    // Search backwards ....
-    int nbr_half_moves = (full_move_count-1)*2 + (!white?1:0);
-    if( nbr_half_moves > nbrof(history)-1 )
-        nbr_half_moves = nbrof(history)-1;
-    if( nbr_half_moves > nbrof(detail_stack)-1 )
-        nbr_half_moves = nbrof(detail_stack)-1;
-    for( int i=0; i<nbr_half_moves; i++ )
-    {
-        Move m = history[--idx];
-        if( m.src == m.dst )
-            break;  // unused history is set to zeroed memory
-        PopMove(m);
-
-        // ... looking for matching positions
-        if( white    == save_white      && // quick ones first!
-            DETAIL_EQ_KING_POSITIONS    &&
-            0 == memcmp(squares,save_squares,sizeof(squares) )
-            )
-        {
+    int matches=1;  // the current position
+    unsigned char idx = detail_idx;    // must be unsigned char
+    for( int i=2; i<=hash64_reversible; i+=2 )
+    {
+        idx -= 2;
+        if( hash64_stack[idx].key == hash64_key )
             matches++;
-            if( !DETAIL_EQ_ALL )    // Castling flags and/or enpassant target different?
-            {
-                // It might not be a match (but it could be - we have to unpack what the differences
-                //  really mean)
-                bool revoke_match = false;
-
-                // Revoke match if different value of en-passant target square means different
-                //  en passant possibilities
-                if( !DETAIL_EQ_EN_PASSANT )
-                {
-                    int ep_saved = (int)(tmp&0xff);
-                    int ep_now   = (int)(*DETAIL_ADDR&0xff);
-
-                    // Work out whether each en_passant is a real one, i.e. is there an opposition
-                    //  pawn in place to capture (if not it's just a double pawn advance with no
-                    //  actual enpassant consequences)
-                    bool real=false;
-                    int ep = ep_saved;
-                    char const *squ = save_squares;
-                    for( int j=0; j<2; j++ )
-                    {
-                        if( ep == 0x10 )    // 0x10 = a6
-                        {
-                             real = (squ[SE(ep)] == 'P');
-                        }
-                        else if( 0x10<ep && ep<0x17 )   // 0x10 = h6
-                        {
-                             real = (squ[SW(ep)] == 'P' || squ[SE(ep)] == 'P');
-                        }
-                        else if( ep==0x17 )
-                        {
-                             real = (squ[SW(ep)] == 'P');
-                        }
-                        else if( 0x28==ep )   // 0x28 = a3
-                        {
-                             real = (squ[NE(ep)] == 'p');
-                        }
-                        else if( 0x28<ep && ep<0x2f )   // 0x2f = h3
-                        {
-                             real = (squ[NE(ep)] == 'p' || squ[NW(ep)] == 'p');
-                        }
-                        else if( ep==0x2f )
-                        {
-                             real = (squ[NW(ep)] == 'p' );
-                        }
-                        if( j > 0 )
-                            ep_now = real?ep:0x40;      // evaluate second time through
-                        else
-                        {
-                            ep_saved = real?ep:0x40;    // evaluate first time through
-                            ep = ep_now;                // setup second time through
-                            squ = squares;
-                            real = false;
-                        }
-                    }
-
-                    // If for example one en_passant is real and the other not, it's not a real match
-                    if( ep_saved != ep_now )
-                        revoke_match = true;
-                }
-
-                // Revoke match if different value of castling flags means different
-                //  castling possibilities
-                if( !revoke_match && !DETAIL_EQ_CASTLING )
-                {
-                    bool wking_saved  = save_squares[e1]=='K' && save_squares[h1]=='R' && (int)(tmp&(WKING<<24));
-                    bool wking_now    = squares[e1]=='K' && squares[h1]=='R' && (int)(*DETAIL_ADDR&(WKING<<24));
-                    bool bking_saved  = save_squares[e8]=='k' && save_squares[h8]=='r' && (int)(tmp&(BKING<<24));
-                    bool bking_now    = squares[e8]=='k' && squares[h8]=='r' && (int)(*DETAIL_ADDR&(BKING<<24));
-                    bool wqueen_saved = save_squares[e1]=='K' && save_squares[a1]=='R' && (int)(tmp&(WQUEEN<<24));
-                    bool wqueen_now   = squares[e1]=='K' && squares[a1]=='R' && (int)(*DETAIL_ADDR&(WQUEEN<<24));
-                    bool bqueen_saved = save_squares[e8]=='k' && save_squares[a8]=='r' && (int)(tmp&(BQUEEN<<24));
-                    bool bqueen_now   = squares[e8]=='k' && squares[a8]=='r' && (int)(*DETAIL_ADDR&(BQUEEN<<24));
-                    revoke_match = ( wking_saved != wking_now ||
-                                     bking_saved != bking_now ||
-                                     wqueen_saved != wqueen_now ||
-                                     bqueen_saved != bqueen_now );
-                }
-
-                // If the real castling or enpassant possibilities differ, it's not a match
-                //  At one stage we just did a naive binary match of the details - not good enough. For example
-                //  a rook moving away from h1 doesn't affect the WKING flag, but does disallow white king side
-                //  castling
-                if( revoke_match )
-                     matches--;
-            }
-        }
-
-        // For performance reasons, abandon search early if pawn move
-        //  or capture
-        if( squares[m.src]=='P' || squares[m.src]=='p' || !IsEmptySquare(m.capture) )
-            break;
     }
-
-    // Restore current position
-    memcpy( squares, save_squares, sizeof(squares) );
-    white      = save_white;
-    detail_idx = save_detail_idx;
-    DETAIL_RESTORE;
-    return( matches+1 );  // +1 counts original position
+    return matches;
 }
 
 /****************************************************************************
@@ -2639,6 +2712,7 @@ bool ChessRules::IsInsufficientDraw( bool white_asks, DRAWTYPE &result )
     return( draw );
 }
 
+#ifndef THC_BITBOARDS
 /****************************************************************************
  * Generate a list of all possible moves in a position
  ****************************************************************************/
@@ -2721,6 +2795,7 @@ void ChessRules::GenMoveList( MOVELIST *l )
         }
     }
 }
+#endif // !THC_BITBOARDS
 
 /****************************************************************************
  * Generate moves for pieces that move along multi-move rays (B,R,Q)
@@ -2815,8 +2890,14 @@ void ChessRules::KingMoves( MOVELIST *l, Square square )
 {
     const lte *ptr = king_lookup[square];
     ShortMoves( l, square, ptr, SPECIAL_KING_MOVE );
+    CastlingMoves( l, square );
+}
 
-    // Generate castling king moves
+/****************************************************************************
+ * Generate castling king moves
+ ****************************************************************************/
+void ChessRules::CastlingMoves( MOVELIST *l, Square square )
+{
     Move *m;
     m = &l->moves[l->count];
 
@@ -3137,11 +3218,60 @@ void ChessRules::BlackPawnMoves( MOVELIST *l, Square square )
     }
 }
 
+/****************************************************************************
+ * Calculate the full 64 bit position key from scratch
+ ****************************************************************************/
+void ChessRules::Hash64KeyCalculate()
+{
+    hash64_state = Hash64StateKey();
+    hash64_key   = Hash64Calculate() ^ hash64_state;
+}
+
+/****************************************************************************
+ * Hash side to move, castling rights and en passant file, only the ones
+ *  that could make a difference to the moves available are included
+ ****************************************************************************/
+uint64_t ChessRules::Hash64StateKey() const
+{
+    uint64_t key = white ? 0 : hash64_black_to_move;
+    if( wking_allowed() )
+        key ^= hash64_castling[0];
+    if( wqueen_allowed() )
+        key ^= hash64_castling[1];
+    if( bking_allowed() )
+        key ^= hash64_castling[2];
+    if( bqueen_allowed() )
+        key ^= hash64_castling[3];
+    Square ep = groomed_enpassant_target();
+    if( ep != SQUARE_INVALID )
+        key ^= hash64_enpassant_file[ ep&0x07 ];
+    return key;
+}
+
 /****************************************************************************
  * Make a move (with the potential to undo)
  ****************************************************************************/
 void ChessRules::PushMove( Move& m )
 {
+#ifdef THC_BITBOARDS
+    // Update piece sets while squares[] still shows the moving piece
+    BitboardsToggle( m );
+#endif
+
+    // Save the key for PopMove(), the squares part of the new key has to be
+    //  worked out before the move is made
+    HASH64_DETAIL &saved = hash64_stack[detail_idx];
+    saved.key        = hash64_key;
+    saved.state      = hash64_state;
+    saved.reversible = hash64_reversible;
+    uint64_t key = Hash64Update( hash64_key, m ) ^ hash64_state;
+
+    // Earlier positions can't recur after a pawn move or capture
+    if( squares[m.src]=='P' || squares[m.src]=='p' || !IsEmptySquare(m.capture) )
+        hash64_reversible = 0;
+    else if( hash64_reversible < 255 )  // the most the stack can look back
+        hash64_reversible++;
+
     // Push old details onto stack
     DETAIL_PUSH;
 
@@ -3261,6 +3391,8 @@ void ChessRules::PushMove( Move& m )
 
     // Toggle who-to-move
     Toggle();
+    hash64_state = Hash64StateKey();
+    hash64_key   = key ^ hash64_state;
 }
 
 /****************************************************************************
@@ -3270,6 +3402,10 @@ void ChessRules::PopMove( Move& m )
 {
     // Previous detail field
     DETAIL_POP;
+    const HASH64_DETAIL &saved = hash64_stack[detail_idx];
+    hash64_key        = saved.key;
+    hash64_state      = saved.state;
+    hash64_reversible = saved.reversible;
 
     // Toggle who-to-move
     Toggle();
@@ -3334,6 +3470,11 @@ void ChessRules::PopMove( Move& m )
         squares[a8] = 'r';
         break;
     }
+
+#ifdef THC_BITBOARDS
+    // squares[] is restored, so the same toggles undo the move
+    BitboardsToggle( m );
+#endif
 }
 
 
@@ -3346,6 +3487,7 @@ bool ChessRules::AttackedPiece( Square square )
     return( AttackedSquare(square,enemy_is_white) );
 }
 
+#ifndef THC_BITBOARDS
 /****************************************************************************
  * Is a square is attacked by enemy ?
  ****************************************************************************/
@@ -3405,6 +3547,309 @@ bool ChessRules::AttackedSquare( Square square, bool enemy_is_white )
     }
     return false;
 }
+#endif // !THC_BITBOARDS
+
+#ifdef THC_BITBOARDS
+/****************************************************************************
+ * Bitboard representation, an alternative to generating moves and testing
+ *  attacks by walking the lte ray tables over squares[]. Build with
+ *  THC_BITBOARDS defined to select it.
+ ****************************************************************************/
+
+/****************************************************************************
+ * Recalculate piece sets from squares[]
+ ****************************************************************************/
+void ChessRules::BitboardsCalculate()
+{
+    BitboardInit();
+    memset( bb_pieces, 0, sizeof(bb_pieces) );
+    memset( bb_colours, 0, sizeof(bb_colours) );
+    for( Square square=a8; square<=h1; ++square )
+    {
+        char piece = squares[square];
+        if( !IsEmptySquare(piece) )
+        {
+            bb_pieces[ bitboard_index[(int)piece] ] |= SQUARE_BIT(square);
+            bb_colours[ IsWhite(piece) ? 0 : 1 ]     |= SQUARE_BIT(square);
+        }
+    }
+}
+
+// Flip one piece in or out of the piece sets
+#define BB_TOGGLE(sq,piece)                                                 \
+    do {                                                                    \
+        bb_pieces[ bitboard_index[(int)(piece)] ] ^= SQUARE_BIT(sq);        \
+        bb_colours[ IsWhite(piece) ? 0 : 1 ]       ^= SQUARE_BIT(sq);       \
+    } while(0)
+
+/****************************************************************************
+ * Flip the bits a move changes, applies or undoes the move
+ ****************************************************************************/
+void ChessRules::BitboardsToggle( const Move &m )
+{
+    char piece = squares[m.src];
+    switch( m.special )
+    {
+        default:
+        BB_TOGGLE( m.src, piece );
+        BB_TOGGLE( m.dst, piece );
+        if( !IsEmptySquare(m.capture) )
+            BB_TOGGLE( m.dst, m.capture );
+        break;
+
+        case SPECIAL_PROMOTION_QUEEN:
+        case SPECIAL_PROMOTION_ROOK:
+        case SPECIAL_PROMOTION_BISHOP:
+        case SPECIAL_PROMOTION_KNIGHT:
+        {
+            char promoted = "QRBN"[m.special-SPECIAL_PROMOTION_QUEEN];
+            if( piece == 'p' )
+                promoted = (char)tolower(promoted);
+            BB_TOGGLE( m.src, piece );
+            BB_TOGGLE( m.dst, promoted );
+            if( !IsEmptySquare(m.capture) )
+                BB_TOGGLE( m.dst, m.capture );
+            break;
+        }
+
+        case SPECIAL_WEN_PASSANT:
+        BB_TOGGLE( m.src, 'P' );
+        BB_TOGGLE( m.dst, 'P' );
+        BB_TOGGLE( SOUTH(m.dst), 'p' );
+        break;
+
+        case SPECIAL_BEN_PASSANT:
+        BB_TOGGLE( m.src, 'p' );
+        BB_TOGGLE( m.dst, 'p' );
+        BB_TOGGLE( NORTH(m.dst), 'P' );
+        break;
+
+        case SPECIAL_WK_CASTLING:
+        BB_TOGGLE( e1, 'K' );   BB_TOGGLE( g1, 'K' );
+        BB_TOGGLE( h1, 'R' );   BB_TOGGLE( f1, 'R' );
+        break;
+        case SPECIAL_WQ_CASTLING:
+        BB_TOGGLE( e1, 'K' );   BB_TOGGLE( c1, 'K' );
+        BB_TOGGLE( a1, 'R' );   BB_TOGGLE( d1, 'R' );
+        break;
+        case SPECIAL_BK_CASTLING:
+        BB_TOGGLE( e8, 'k' );   BB_TOGGLE( g8, 'k' );
+        BB_TOGGLE( h8, 'r' );   BB_TOGGLE( f8, 'r' );
+        break;
+        case SPECIAL_BQ_CASTLING:
+        BB_TOGGLE( e8, 'k' );   BB_TOGGLE( c8, 'k' );
+        BB_TOGGLE( a8, 'r' );   BB_TOGGLE( d8, 'r' );
+        break;
+    }
+}
+
+/****************************************************************************
+ * Is a square is attacked by enemy ? (bitboard version)
+ ****************************************************************************/
+bool ChessRules::AttackedSquare( Square square, bool enemy_is_white )
+{
+    const uint64_t *enemy = bb_pieces + (enemy_is_white ? 0 : BB_BLACK);
+    uint64_t occupied = bb_colours[0] | bb_colours[1];
+
+    // An enemy pawn attacks square if it stands where one of our pawns on
+    //  square would attack
+    if( (pawn_attacks[enemy_is_white?1:0][square] & enemy[BB_PAWN])  ||
+        (knight_attacks[square] & enemy[BB_KNIGHT])                  ||
+        (king_attacks[square] & enemy[BB_KING])
+      )
+        return true;
+    if( BishopAttacks(square,occupied) & (enemy[BB_BISHOP]|enemy[BB_QUEEN]) )
+        return true;
+    return( (RookAttacks(square,occupied) & (enemy[BB_ROOK]|enemy[BB_QUEEN])) != 0 );
+}
+
+/****************************************************************************
+ * Find checking and pinned pieces (bitboard version), see mailbox version
+ *  for details
+ ****************************************************************************/
+uint64_t ChessRules::GenCheckAndPinMasks( uint64_t &pinned, uint64_t pin_rays[64] )
+{
+    Square king = (Square)(white ? wking_square : bking_square);
+    const uint64_t *enemy = bb_pieces + (white ? BB_BLACK : 0);
+    uint64_t ours     = bb_colours[white ? 0 : 1];
+    uint64_t occupied = bb_colours[0] | bb_colours[1];
+    uint64_t diagonal   = enemy[BB_BISHOP] | enemy[BB_QUEEN];
+    uint64_t orthogonal = enemy[BB_ROOK]   | enemy[BB_QUEEN];
+
+    uint64_t checkers = (pawn_attacks[white?0:1][king] & enemy[BB_PAWN])  |
+                        (knight_attacks[king] & enemy[BB_KNIGHT])         |
+                        (BishopAttacks(king,occupied) & diagonal)         |
+                        (RookAttacks(king,occupied) & orthogonal);
+
+    // A slider with exactly one of our men between it and the king pins it
+    pinned = 0;
+    uint64_t snipers = (BishopAttacks(king,0) & diagonal) |
+                       (RookAttacks(king,0) & orthogonal);
+    while( snipers )
+    {
+        int sniper = BitboardPopLsb( snipers );
+        uint64_t blockers = between_squares[king][sniper] & occupied;
+        if( blockers && !(blockers & (blockers-1)) && (blockers & ours) )
+        {
+            pinned |= blockers;
+            pin_rays[ BitboardLsb(blockers) ] = line_through[king][sniper];
+        }
+    }
+
+    if( checkers == 0 )
+        return ~(uint64_t)0;
+    if( checkers & (checkers-1) )
+        return 0;   // double check, only the king can move
+    int checker = BitboardLsb( checkers );
+    return between_squares[king][checker] | checkers;
+}
+
+// Add a move to each square in a set of destinations
+static inline void bb_add_moves( MOVELIST *l, Square src, uint64_t targets,
+                                 SPECIAL special, const char *squares )
+{
+    Move *m = &l->moves[l->count];
+    while( targets )
+    {
+        Square dst = (Square)BitboardPopLsb( targets );
+        m->src     = src;
+        m->dst     = dst;
+        m->special = special;
+        m->capture = squares[dst];
+        m++;
+        l->count++;
+    }
+}
+
+// Add pawn moves to each square in a set of destinations, src is found
+//  by stepping back offset squares, promotions are generated in the order
+//  (Q),N,B,R as the mailbox generator does
+static inline void bb_add_pawn_moves( MOVELIST *l, uint64_t targets, int offset,
+                                      uint64_t promotion_rank, SPECIAL special,
+                                      const char *squares )
+{
+    Move *m = &l->moves[l->count];
+    while( targets )
+    {
+        Square dst = (Square)BitboardPopLsb( targets );
+        Square src = (Square)(dst - offset);
+        if( SQUARE_BIT(dst) & promotion_rank )
+        {
+            static const SPECIAL promotions[4] =
+            {
+                SPECIAL_PROMOTION_QUEEN,  SPECIAL_PROMOTION_KNIGHT,
+                SPECIAL_PROMOTION_BISHOP, SPECIAL_PROMOTION_ROOK
+            };
+            for( int i=0; i<4; i++ )
+            {
+                m->src     = src;
+                m->dst     = dst;
+                m->special = promotions[i];
+                m->capture = squares[dst];
+                m++;
+                l->count++;
+            }
+        }
+        else
+        {
+            m->src     = src;
+            m->dst     = dst;
+            m->special = special;
+            m->capture = squares[dst];
+            m++;
+            l->count++;
+        }
+    }
+}
+
+/****************************************************************************
+ * Generate a list of all possible moves in a position (bitboard version)
+ ****************************************************************************/
+void ChessRules::GenMoveList( MOVELIST *l )
+{
+    // See the mailbox version for the reasons for these asserts
+    assert( sizeof(ChessPositionRaw) ==
+               (offsetof(ChessPositionRaw,full_move_count) + sizeof(full_move_count) + sizeof(DETAIL))
+          );
+    assert( sizeof(Move) == sizeof(int32_t) );
+
+    l->count = 0;
+    const uint64_t *own = bb_pieces + (white ? 0 : BB_BLACK);
+    uint64_t ours     = bb_colours[white ? 0 : 1];
+    uint64_t theirs   = bb_colours[white ? 1 : 0];
+    uint64_t occupied = ours | theirs;
+    uint64_t empty    = ~occupied;
+    uint64_t targets  = ~ours;
+
+    // Pawns, moving all of them at once. North is towards bit 0
+    uint64_t pawns = own[BB_PAWN];
+    if( white )
+    {
+        uint64_t push1 = (pawns >> 8) & empty;
+        uint64_t push2 = ((push1 & BB_RANK_3) >> 8) & empty;
+        bb_add_pawn_moves( l, push1, -8, BB_RANK_8, NOT_SPECIAL, squares );
+        bb_add_pawn_moves( l, push2, -16, 0, SPECIAL_WPAWN_2SQUARES, squares );
+        bb_add_pawn_moves( l, ((pawns & ~BB_FILE_A) >> 9) & theirs, -9, BB_RANK_8, NOT_SPECIAL, squares );
+        bb_add_pawn_moves( l, ((pawns & ~BB_FILE_H) >> 7) & theirs, -7, BB_RANK_8, NOT_SPECIAL, squares );
+    }
+    else
+    {
+        uint64_t push1 = (pawns << 8) & empty;
+        uint64_t push2 = ((push1 & BB_RANK_6) << 8) & empty;
+        bb_add_pawn_moves( l, push1, 8, BB_RANK_1, NOT_SPECIAL, squares );
+        bb_add_pawn_moves( l, push2, 16, 0, SPECIAL_BPAWN_2SQUARES, squares );
+        bb_add_pawn_moves( l, ((pawns & ~BB_FILE_A) << 7) & theirs, 7, BB_RANK_1, NOT_SPECIAL, squares );
+        bb_add_pawn_moves( l, ((pawns & ~BB_FILE_H) << 9) & theirs, 9, BB_RANK_1, NOT_SPECIAL, squares );
+    }
+
+    // En passant, our pawns stand where an enemy pawn on the target would
+    //  attack
+    if( enpassant_target != SQUARE_INVALID )
+    {
+        uint64_t attackers = pawn_attacks[white?1:0][enpassant_target] & pawns;
+        while( attackers )
+        {
+            Move *m = &l->moves[l->count++];
+            m->src     = (Square)BitboardPopLsb( attackers );
+            m->dst     = (Square)enpassant_target;
+            m->special = white ? SPECIAL_WEN_PASSANT : SPECIAL_BEN_PASSANT;
+            m->capture = white ? 'p' : 'P';
+        }
+    }
+
+    uint64_t pieces = own[BB_KNIGHT];
+    while( pieces )
+    {
+        Square src = (Square)BitboardPopLsb( pieces );
+        bb_add_moves( l, src, knight_attacks[src] & targets, NOT_SPECIAL, squares );
+    }
+    pieces = own[BB_BISHOP];
+    while( pieces )
+    {
+        Square src = (Square)BitboardPopLsb( pieces );
+        bb_add_moves( l, src, BishopAttacks(src,occupied) & targets, NOT_SPECIAL, squares );
+    }
+    pieces = own[BB_ROOK];
+    while( pieces )
+    {
+        Square src = (Square)BitboardPopLsb( pieces );
+        bb_add_moves( l, src, RookAttacks(src,occupied) & targets, NOT_SPECIAL, squares );
+    }
+    pieces = own[BB_QUEEN];
+    while( pieces )
+    {
+        Square src = (Square)BitboardPopLsb( pieces );
+        bb_add_moves( l, src, QueenAttacks(src,occupied) & targets, NOT_SPECIAL, squares );
+    }
+    pieces = own[BB_KING];
+    while( pieces )
+    {
+        Square src = (Square)BitboardPopLsb( pieces );
+        bb_add_moves( l, src, king_attacks[src] & targets, SPECIAL_KING_MOVE, squares );
+        CastlingMoves( l, src );
+    }
+}
+#endif // THC_BITBOARDS
 
 /****************************************************************************
  * Evaluate a position, returns bool okay (not okay means illegal position)
@@ -3539,6 +3984,10 @@ void ChessRules::Transform()
             }
         }
     }
+#ifdef THC_BITBOARDS
+    BitboardsCalculate();
+#endif
+    Hash64KeyCalculate();
 }
 
 
@@ -4345,9 +4794,6 @@ static int king_ending_bonus_static[] =
     #endif
 };
 
-static int king_ending_bonus_dynamic_white[0x80];
-static int king_ending_bonus_dynamic_black[0x80];
-
 // Lookup table for quick calculation of material value of white piece
 static int white_material[]=
 {
@@ -4480,10 +4926,10 @@ void ChessEvaluation::Planning()
         // Reset dynamic king position arrays
         memcpy( king_ending_bonus_dynamic_white,
                 king_ending_bonus_static,
-                sizeof(king_ending_bonus_dynamic_white) );
+                sizeof(king_ending_bonus_static) );
         memcpy( king_ending_bonus_dynamic_black,
                 king_ending_bonus_static,
-                sizeof(king_ending_bonus_dynamic_black) );
+                sizeof(king_ending_bonus_static) );
 
         // Encourage kings to go where the pawns are
         #ifdef USE_CHASE_PAWNS
@@ -5747,6 +6193,11 @@ void ChessEvaluation::GenLegalMoveListSorted( MOVELIST *list )
  ****************************************************************************/
 bool Move::NaturalIn( ChessRules *cr, const char *natural_in )
 {
+    // Standard algebraic notation is read straight from the board, the move
+    //  list search below is for the looser forms
+    if( SanIn(cr,natural_in) )
+        return true;
+
     MOVELIST list;
     int  i, len=0;
     char src_file='\0', src_rank='\0', dst_file='\0', dst_rank='\0';
@@ -6452,12 +6903,9 @@ bool Move::NaturalInFast( ChessRules *cr, const char *natural_in )
                                                     else // probe==1 means disambiguate by testing whether move is legal, found will be set if
                                                         // we are not exposing white king to check.
                                                     {
-                                                        char temp = cr->squares[mv.dst];
-                                                        cr->squares[mv.dst] = 'N';  // temporarily make move
-                                                        cr->squares[src_] = ' ';
-                                                        found = !cr->AttackedSquare( cr->wking_square, false ); //bool AttackedSquare( Square square, bool enemy_is_white );
-                                                        cr->squares[mv.dst] = temp;  // now undo move
-                                                        cr->squares[src_] = 'N';
+                                                        cr->PushMove( mv );  // temporarily make move
+                                                        found = cr->Evaluate();  // legal if it doesn't expose our king
+                                                        cr->PopMove( mv );  // now undo move
                                                     }
                                                 }
                                             }
@@ -6496,12 +6944,9 @@ bool Move::NaturalInFast( ChessRules *cr, const char *natural_in )
                                                             else // probe==1 means disambiguate by testing whether move is legal, found will be set if
                                                                 // we are not exposing white king to check.
                                                             {
-                                                                char temp = cr->squares[mv.dst];
-                                                                cr->squares[mv.dst] = piece;  // temporarily make move
-                                                                cr->squares[mv.src] = ' ';
-                                                                found = !cr->AttackedSquare( cr->wking_square, false ); //bool AttackedSquare( Square square, bool enemy_is_white );
-                                                                cr->squares[mv.dst] = temp;  // now undo move
-                                                                cr->squares[mv.src] = piece;
+                                                                cr->PushMove( mv );  // temporarily make move
+                                                                found = cr->Evaluate();  // legal if it doesn't expose our king
+                                                                cr->PopMove( mv );  // now undo move
                                                             }
                                                         }
                                                     }
@@ -6806,12 +7251,9 @@ bool Move::NaturalInFast( ChessRules *cr, const char *natural_in )
                                                     else // probe==1 means disambiguate by testing whether move is legal, found will be set if
                                                         // we are not exposing black king to check.
                                                     {
-                                                        char temp = cr->squares[mv.dst];
-                                                        cr->squares[mv.dst] = 'n';  // temporarily make move
-                                                        cr->squares[mv.src] = ' ';
-                                                        found = !cr->AttackedSquare( cr->bking_square, true ); //bool AttackedSquare( Square square, bool enemy_is_white );
-                                                        cr->squares[mv.dst] = temp;  // now undo move
-                                                        cr->squares[mv.src] = 'n';
+                                                        cr->PushMove( mv );  // temporarily make move
+                                                        found = cr->Evaluate();  // legal if it doesn't expose our king
+                                                        cr->PopMove( mv );  // now undo move
                                                     }
                                                 }
                                             }
@@ -6850,12 +7292,9 @@ bool Move::NaturalInFast( ChessRules *cr, const char *natural_in )
                                                             else // probe==1 means disambiguate by testing whether move is legal, found will be set if
                                                                 // we are not exposing black king to check.
                                                             {
-                                                                char temp = cr->squares[mv.dst];
-                                                                cr->squares[mv.dst] = piece;  // temporarily make move
-                                                                cr->squares[mv.src] = ' ';
-                                                                found = !cr->AttackedSquare( cr->bking_square, true ); //bool AttackedSquare( Square square, bool enemy_is_white );
-                                                                cr->squares[mv.dst] = temp;  // now undo move
-                                                                cr->squares[mv.src] = piece;
+                                                                cr->PushMove( mv );  // temporarily make move
+                                                                found = cr->Evaluate();  // legal if it doesn't expose our king
+                                                                cr->PopMove( mv );  // now undo move
                                                             }
                                                         }
                                                     }
@@ -6885,6 +7324,496 @@ bool Move::NaturalInFast( ChessRules *cr, const char *natural_in )
     return found;
 }
 
+/****************************************************************************
+ * Standard algebraic notation straight from the board. The source square is
+ *  found from the lookup tables for the moving piece and destination only,
+ *  so no move list is generated
+ ****************************************************************************/
+
+// Character classes for the SAN decoder
+enum SAN_CLASS
+{
+    SAN_OTHER = 0,
+    SAN_FILE,       // a-h
+    SAN_RANK,       // 1-8
+    SAN_PIECE,      // K, Q, R, B, N
+    SAN_CAPTURE,    // x
+    SAN_PROMOTE,    // =
+    SAN_CASTLE,     // O, or 0 as some programs write it
+    SAN_SUFFIX,     // check, mate and annotation marks
+    SAN_END         // end of string or whitespace
+};
+
+struct SanTable
+{
+    unsigned char cls[256];
+    constexpr SanTable() : cls()
+    {
+        for( int c='a'; c<='h'; c++ )
+            cls[c] = SAN_FILE;
+        for( int c='1'; c<='8'; c++ )
+            cls[c] = SAN_RANK;
+        cls['K'] = cls['Q'] = cls['R'] = cls['B'] = cls['N'] = SAN_PIECE;
+        cls['x'] = SAN_CAPTURE;
+        cls['='] = SAN_PROMOTE;
+        cls['O'] = cls['0'] = SAN_CASTLE;
+        cls['+'] = cls['#'] = cls['!'] = cls['?'] = SAN_SUFFIX;
+        cls['\0'] = cls[' '] = cls['\t'] = cls['\r'] = cls['\n'] = SAN_END;
+    }
+};
+static constexpr SanTable san_table;
+
+// The eight directions a queen moves in, the rook's first, and how many
+//  squares lie that way from each square before the edge of the board
+struct SanRays
+{
+    int step[8];
+    unsigned char length[64][8];
+    constexpr SanRays() : step{ -8, 8, -1, 1, -9, -7, 7, 9 }, length()
+    {
+        for( int sq=0; sq<64; sq++ )
+        {
+            int north=sq>>3, south=7-north, west=sq&7, east=7-west;
+            unsigned char *len = length[sq];
+            len[0] = north;
+            len[1] = south;
+            len[2] = west;
+            len[3] = east;
+            len[4] = north<west ? north : west;
+            len[5] = north<east ? north : east;
+            len[6] = south<west ? south : west;
+            len[7] = south<east ? south : east;
+        }
+    }
+};
+static constexpr SanRays san_rays;
+
+// Squares holding piece (eg 'N' or 'q') that reach dst, ignoring pins.
+//  No square is reached by more than 8 pieces of a kind
+static int san_sources( const ChessRules *cr, char piece, Square dst,
+                        Square sources[8] )
+{
+    int count = 0;
+    switch( piece )
+    {
+        case 'K':
+        case 'k':
+        {
+            // There is only the one king
+            int king = piece=='K' ? cr->wking_square : cr->bking_square;
+            int file_delta = IFILE(king) - IFILE(dst);
+            int row_delta  = (king>>3) - ((int)dst>>3);
+            if( king!=dst && file_delta>=-1 && file_delta<=1 &&
+                row_delta>=-1 && row_delta<=1 )
+                sources[count++] = (Square)king;
+            break;
+        }
+        case 'N':
+        case 'n':
+        {
+            const lte *ptr = knight_lookup[dst];
+            lte nbr_moves = *ptr++;
+            while( nbr_moves-- )
+            {
+                Square src_ = (Square)*ptr++;
+                if( cr->squares[src_] == piece )
+                    sources[count++] = src_;
+            }
+            break;
+        }
+        default:
+        {
+            // Rook lines first then diagonals, stepping along each to the
+            //  first man, who may be the piece
+            int first = (piece=='B' || piece=='b') ? 4 : 0;
+            int last  = (piece=='R' || piece=='r') ? 4 : 8;
+            const unsigned char *lengths = san_rays.length[dst];
+            for( int dir=first; dir<last; dir++ )
+            {
+                int step = san_rays.step[dir];
+                int sq = dst;
+                for( int n=lengths[dir]; n>0; n-- )
+                {
+                    sq += step;
+                    char man = cr->squares[sq];
+                    if( !IsEmptySquare(man) )
+                    {
+                        if( man == piece )
+                            sources[count++] = (Square)sq;
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+    }
+    return count;
+}
+
+// Whether the side to move is in check. Kings never touch, so only the
+//  first man on each of the king's lines, knights and pawns are looked at
+static bool san_in_check( const ChessRules *cr )
+{
+    bool white = cr->white;
+    int king = white ? cr->wking_square : cr->bking_square;
+    char queen = white ? 'q' : 'Q';
+    const unsigned char *lengths = san_rays.length[king];
+    for( int dir=0; dir<8; dir++ )
+    {
+        char slider = dir<4 ? (white?'r':'R') : (white?'b':'B');
+        int step = san_rays.step[dir];
+        int sq = king;
+        for( int n=lengths[dir]; n>0; n-- )
+        {
+            sq += step;
+            char man = cr->squares[sq];
+            if( !IsEmptySquare(man) )
+            {
+                if( man==slider || man==queen )
+                    return true;
+                break;
+            }
+        }
+    }
+    char knight = white ? 'n' : 'N';
+    const lte *ptr = knight_lookup[king];
+    lte nbr_squares = *ptr++;
+    while( nbr_squares-- )
+    {
+        if( cr->squares[*ptr++] == knight )
+            return true;
+    }
+
+    // Black pawns attack towards the south (higher squares) and vice versa
+    int row = (king>>3) + (white ? -1 : 1);
+    char pawn = white ? 'p' : 'P';
+    if( row<0 || row>7 )
+        return false;
+    int file = IFILE(king);
+    return (file>0 && cr->squares[row*8+file-1]==pawn) ||
+           (file<7 && cr->squares[row*8+file+1]==pawn);
+}
+
+// Whether a move that follows the piece's rules leaves our king safe. Out
+//  of check only a man pinned to the king and leaving the line of the pin
+//  can expose it, so that is all that is looked for. King moves test the
+//  destination with the king lifted off the board, as GenLegalMoveList()
+//  does, and the rare cases left are played and tested
+static bool san_legal( ChessRules *cr, Move mv, bool in_check )
+{
+    bool white = cr->white;
+    if( mv.special == SPECIAL_KING_MOVE )
+    {
+        char king = cr->squares[mv.src];
+        cr->squares[mv.src] = ' ';
+#ifdef THC_BITBOARDS
+        cr->bb_colours[white?0:1] ^= SQUARE_BIT(mv.src);
+#endif
+        bool legal = !cr->AttackedSquare( mv.dst, !white );
+#ifdef THC_BITBOARDS
+        cr->bb_colours[white?0:1] ^= SQUARE_BIT(mv.src);
+#endif
+        cr->squares[mv.src] = king;
+        return legal;
+    }
+    if( in_check || mv.special==SPECIAL_WEN_PASSANT ||
+                    mv.special==SPECIAL_BEN_PASSANT )
+    {
+        cr->PushMove( mv );
+        bool legal = cr->Evaluate();
+        cr->PopMove( mv );
+        return legal;
+    }
+
+    // A man off the king's lines, or with something between, isn't pinned
+    int king = white ? cr->wking_square : cr->bking_square;
+    int file_delta = IFILE(mv.src) - IFILE(king);
+    int row_delta  = ((int)mv.src>>3) - (king>>3);
+    bool diagonal = (file_delta!=0 && row_delta!=0);
+    if( diagonal && file_delta!=row_delta && file_delta!=-row_delta )
+        return true;
+    int step = (file_delta>0) - (file_delta<0) + 8*((row_delta>0) - (row_delta<0));
+    int sq = king + step;
+    for( ; sq!=mv.src; sq+=step )
+    {
+        if( !IsEmptySquare(cr->squares[sq]) )
+            return true;
+    }
+
+    // Pinned if the first man beyond it on the line is an enemy slider
+    //  moving that way, it may then only move along the line
+    int file = IFILE(sq), row = sq>>3;
+    int file_step = (file_delta>0) - (file_delta<0);
+    int row_step  = (row_delta>0) - (row_delta<0);
+    for(;;)
+    {
+        file += file_step;
+        row  += row_step;
+        if( file<0 || file>7 || row<0 || row>7 )
+            return true;
+        char piece = cr->squares[row*8+file];
+        if( IsEmptySquare(piece) )
+            continue;
+        char slider = diagonal ? (white?'b':'B') : (white?'r':'R');
+        if( piece!=slider && piece!=(white?'q':'Q') )
+            return true;
+        break;
+    }
+    int dst_file_delta = IFILE(mv.dst) - IFILE(king);
+    int dst_row_delta  = ((int)mv.dst>>3) - (king>>3);
+    return dst_file_delta*row_delta == dst_row_delta*file_delta &&
+           (dst_file_delta>0) - (dst_file_delta<0) == file_step &&
+           (dst_row_delta>0) - (dst_row_delta<0) == row_step;
+}
+
+// How many of the sources can move legally to mv.dst, mv.src is set to the
+//  first of them
+static int san_choose( ChessRules *cr, Move &mv, const Square *sources,
+                       int count, bool in_check )
+{
+    int legal = 0;
+    Move candidate = mv;
+    for( int i=0; i<count; i++ )
+    {
+        candidate.src = sources[i];
+        if( san_legal(cr,candidate,in_check) && !legal++ )
+            mv.src = candidate.src;
+    }
+    return legal;
+}
+
+// Castling, if the rights, empty squares and unattacked king path allow it
+static bool san_castling( ChessRules *cr, bool queen_side, Move &mv )
+{
+    bool white = cr->white;
+    Square king = white ? e1 : e8;
+    Square rook = queen_side ? (white?a1:a8) : (white?h1:h8);
+    int step = queen_side ? -1 : 1;
+    bool allowed = white ? (queen_side ? cr->wqueen : cr->wking)
+                         : (queen_side ? cr->bqueen : cr->bking);
+    if( !allowed || cr->squares[king]!=(white?'K':'k') ||
+                    cr->squares[rook]!=(white?'R':'r') )
+        return false;
+    for( int sq=king+step; sq!=rook; sq+=step )
+    {
+        if( !IsEmptySquare(cr->squares[sq]) )
+            return false;
+    }
+    for( int i=0; i<3; i++ )
+    {
+        if( cr->AttackedSquare( (Square)(king+i*step), !white ) )
+            return false;
+    }
+    mv.src     = king;
+    mv.dst     = (Square)(king+2*step);
+    mv.capture = ' ';
+    if( white )
+        mv.special = queen_side ? SPECIAL_WQ_CASTLING : SPECIAL_WK_CASTLING;
+    else
+        mv.special = queen_side ? SPECIAL_BQ_CASTLING : SPECIAL_BK_CASTLING;
+    return true;
+}
+
+/****************************************************************************
+ * Read standard algebraic notation eg "Nf3", "exd8=Q+"
+ *  return bool okay
+ ****************************************************************************/
+bool Move::SanIn( ChessRules *cr, const char *san, bool trusted )
+{
+    const unsigned char *s = (const unsigned char *)san;
+    const unsigned char *cls = san_table.cls;
+    bool white = cr->white;
+    Move mv;
+    mv.special = NOT_SPECIAL;
+    mv.capture = ' ';
+
+    // Castling, "O-O" or "O-O-O"
+    if( cls[*s] == SAN_CASTLE )
+    {
+        unsigned char o = *s;
+        bool queen_side = (s[1]=='-' && s[2]==o && s[3]=='-' && s[4]==o);
+        if( queen_side )
+            s += 5;
+        else if( s[1]=='-' && s[2]==o )
+            s += 3;
+        else
+            return false;
+        while( cls[*s] == SAN_SUFFIX )
+            s++;
+        if( cls[*s]!=SAN_END || !san_castling(cr,queen_side,mv) )
+            return false;
+        *this = mv;
+        return true;
+    }
+
+    // Piece, then up to four coordinates, the last two the destination. An
+    //  'x' may only come right before the destination, though a missing or
+    //  needless 'x' is forgiven as NaturalIn() forgives it
+    char piece = 'P';
+    if( cls[*s] == SAN_PIECE )
+        piece = (char)*s++;
+    char coords[4];
+    int n=0, capture_at=-1;
+    for(;;)
+    {
+        unsigned char c = cls[*s];
+        if( (c==SAN_FILE || c==SAN_RANK) && n<4 )
+            coords[n++] = (char)*s++;
+        else if( c==SAN_CAPTURE && capture_at<0 )
+        {
+            capture_at = n;
+            s++;
+        }
+        else
+            break;
+    }
+    if( n<2 || cls[(unsigned char)coords[n-2]]!=SAN_FILE
+            || cls[(unsigned char)coords[n-1]]!=SAN_RANK )
+        return false;
+    if( capture_at>=0 && capture_at!=n-2 )
+        return false;
+    char src_file='\0', src_rank='\0';
+    if( n == 3 )
+    {
+        if( cls[(unsigned char)coords[0]] == SAN_FILE )
+            src_file = coords[0];
+        else
+            src_rank = coords[0];
+    }
+    else if( n == 4 )
+    {
+        if( cls[(unsigned char)coords[0]]!=SAN_FILE || cls[(unsigned char)coords[1]]!=SAN_RANK )
+            return false;
+        src_file = coords[0];
+        src_rank = coords[1];
+    }
+    char dst_file = coords[n-2];
+    char dst_rank = coords[n-1];
+    mv.dst = SQ(dst_file,dst_rank);
+
+    // Promotion, the '=' may be left out
+    char promotion = '\0';
+    if( cls[*s] == SAN_PROMOTE )
+    {
+        s++;
+        if( cls[*s] != SAN_PIECE )
+            return false;
+        promotion = (char)*s++;
+    }
+    else if( piece=='P' && cls[*s]==SAN_PIECE )
+        promotion = (char)*s++;
+    while( cls[*s] == SAN_SUFFIX )
+        s++;
+    if( cls[*s]!=SAN_END || promotion=='K' || (promotion && piece!='P') )
+        return false;
+
+    // Can't take our own men
+    char target = cr->squares[mv.dst];
+    if( white ? IsWhite(target) : IsBlack(target) )
+        return false;
+    mv.capture = target;
+
+    if( piece == 'P' )
+    {
+        char pawn = white ? 'P' : 'p';
+        int forward = white ? 1 : -1;
+        char src_rank_ = (char)(dst_rank-forward);
+        if( src_rank || src_rank_<'2' || src_rank_>'7' )
+            return false;
+        if( capture_at>=0 && (!src_file || src_file==dst_file) )
+            return false;
+
+        // Capture, "exd5"
+        if( src_file && src_file!=dst_file )
+        {
+            if( src_file-dst_file!=1 && dst_file-src_file!=1 )
+                return false;
+            mv.src = SQ(src_file,src_rank_);
+            if( cr->squares[mv.src] != pawn )
+                return false;
+            if( IsEmptySquare(target) )
+            {
+                Square passed = SQ(dst_file,src_rank_);
+                if( mv.dst!=cr->enpassant_target ||
+                    dst_rank!=(white?'6':'3') ||
+                    cr->squares[passed]!=(white?'p':'P') )
+                    return false;
+                mv.capture = white ? 'p' : 'P';
+                mv.special = white ? SPECIAL_WEN_PASSANT : SPECIAL_BEN_PASSANT;
+            }
+        }
+
+        // Push, "e4"
+        else
+        {
+            if( !IsEmptySquare(target) )
+                return false;
+            mv.src = SQ(dst_file,src_rank_);
+            if( cr->squares[mv.src] != pawn )
+            {
+                if( !IsEmptySquare(cr->squares[mv.src]) ||
+                    dst_rank!=(white?'4':'5') )
+                    return false;
+                mv.src = SQ(dst_file,(char)(src_rank_-forward));
+                if( cr->squares[mv.src] != pawn )
+                    return false;
+                mv.special = white ? SPECIAL_WPAWN_2SQUARES : SPECIAL_BPAWN_2SQUARES;
+            }
+        }
+
+        // Promotion is to a queen unless it says otherwise
+        if( dst_rank == (white?'8':'1') )
+        {
+            switch( promotion )
+            {
+                default:
+                case 'Q':   mv.special = SPECIAL_PROMOTION_QUEEN;   break;
+                case 'R':   mv.special = SPECIAL_PROMOTION_ROOK;    break;
+                case 'B':   mv.special = SPECIAL_PROMOTION_BISHOP;  break;
+                case 'N':   mv.special = SPECIAL_PROMOTION_KNIGHT;  break;
+            }
+        }
+        else if( promotion )
+            return false;
+        if( !trusted && !san_legal(cr,mv,san_in_check(cr)) )
+            return false;
+    }
+
+    // Piece move, exactly one of the pieces reaching dst must match the
+    //  disambiguation and move legally. Trusted, a single match is taken
+    //  as it is
+    else
+    {
+        Square sources[8];
+        char own = white ? piece : (char)(piece-'A'+'a');
+        int count = san_sources( cr, own, mv.dst, sources );
+        int matches = 0;
+        for( int i=0; i<count; i++ )
+        {
+            if( (!src_file || FILE(sources[i])==src_file) &&
+                (!src_rank || RANK(sources[i])==src_rank) )
+                sources[matches++] = sources[i];
+        }
+        if( piece == 'K' )
+            mv.special = SPECIAL_KING_MOVE;
+        if( matches==1 && trusted )
+            mv.src = sources[0];
+        else
+        {
+            // Trusted, the pin test alone tells the pieces apart unless
+            //  more than one passes it, as they may when in check
+            bool in_check = !trusted && matches>0 && san_in_check(cr);
+            int legal = san_choose( cr, mv, sources, matches, in_check );
+            if( legal>1 && trusted && san_in_check(cr) )
+                legal = san_choose( cr, mv, sources, matches, true );
+            if( legal != 1 )
+                return false;
+        }
+    }
+    *this = mv;
+    return true;
+}
+
 /****************************************************************************
  * Read terse string move eg "g1f3"
  *  return bool okay
@@ -6960,200 +7889,103 @@ bool Move::TerseIn( ChessRules *cr, const char *tmove )
  ****************************************************************************/
 std::string Move::NaturalOut( ChessRules *cr )
 {
+    char nmove[MAXNATURAL];
+    NaturalOut( cr, nmove );
+    return nmove;
+}
 
-// Improved algorithm
-
-    /* basic procedure is run the following algorithms in turn:
-        pawn move     ?
-        castling      ?
-        Nd2 or Nxd2   ? (loop through all legal moves check if unique)
-        Nbd2 or Nbxd2 ? (loop through all legal moves check if unique)
-        N1d2 or N1xd2 ? (loop through all legal moves check if unique)
-        Nb1d2 or Nb1xd2 (fallback if nothing else works)
-    */
+/****************************************************************************
+ * Convert to natural string in a caller's buffer
+ *    eg "Nf3", "--" if the move isn't legal
+ ****************************************************************************/
+void Move::NaturalOut( ChessRules *cr, char nmove[MAXNATURAL] )
+{
+    char *s = nmove;
+    char p = cr->squares[src];
+    if( special==SPECIAL_WK_CASTLING || special==SPECIAL_BK_CASTLING )
+        s = strcpy( s, "O-O" ) + 3;
+    else if( special==SPECIAL_WQ_CASTLING || special==SPECIAL_BQ_CASTLING )
+        s = strcpy( s, "O-O-O" ) + 5;
 
-    char nmove[10];
-    nmove[0] = '-';
-    nmove[1] = '-';
-    nmove[2] = '\0';
-    MOVELIST list;
-    bool check[MAXMOVES];
-    bool mate[MAXMOVES];
-    bool stalemate[MAXMOVES];
-    enum
-    {
-        ALG_PAWN_MOVE,
-        ALG_CASTLING,
-        ALG_ND2,
-        ALG_NBD2,
-        ALG_N1D2,
-        ALG_NB1D2
-    };
-    bool done=false;
-    bool found = false;
-    char append='\0';
-    cr->GenLegalMoveList( &list, check, mate, stalemate );
-    Move mfound = list.moves[0];   // just to prevent a bogus compiler uninitialized var warning
-    for( int i=0; !found && i<list.count; i++ )
+    // Pawn move, "e4" or "exf6", plus "=Q" etc if promotion
+    else if( p=='P' || p=='p' )
     {
-        mfound = list.moves[i];
-        if( mfound == *this )
+        if( !IsEmptySquare(capture) )
+        {
+            *s++ = FILE(src);
+            *s++ = 'x';
+        }
+        *s++ = FILE(dst);
+        *s++ = RANK(dst);
+        char promotion = '\0';
+        switch( special )
+        {
+            case SPECIAL_PROMOTION_QUEEN:   promotion = 'Q';    break;
+            case SPECIAL_PROMOTION_ROOK:    promotion = 'R';    break;
+            case SPECIAL_PROMOTION_BISHOP:  promotion = 'B';    break;
+            case SPECIAL_PROMOTION_KNIGHT:  promotion = 'N';    break;
+            default:                                            break;
+        }
+        if( promotion )
         {
-            found = true;
-            if( mate[i] )
-                append = '#';
-            else if( check[i] )
-                append = '+';
+            *s++ = '=';
+            *s++ = promotion;
         }
     }
 
-    // Loop through algorithms
-    for( int alg=ALG_PAWN_MOVE; found && !done && alg<=ALG_NB1D2; alg++ )
+    // Piece move, with the file, rank or both of the source if another
+    //  piece of the same kind can legally move to dst too
+    else
     {
-        bool do_loop = (alg==ALG_ND2 || alg==ALG_NBD2 || alg==ALG_N1D2);
-        int matches=0;
-        Move m;
-
-        // Run the algorithm on the input move (i=-1) AND on all legal moves
-        //  in a loop if do_loop set for this algorithm (i=0 to i=count-1)
-        for( int i=-1; !done && i<(do_loop?list.count:0); i++ )
-        {
-            char *str_dst;
-            char compare[10];
-            if( i == -1 )
-            {
-                m = *this;
-                str_dst = nmove;
-            }
-            else
-            {
-                m = list.moves[i];
-                str_dst = compare;
-            }
-            Square src_ = m.src;
-            Square dst_ = m.dst;
-            char t, p = cr->squares[src_];
-            if( islower(p) )
-                p = (char)toupper(p);
-            if( !IsEmptySquare(m.capture) ) // until we did it this way, enpassant was '-' instead of 'x'
-                t = 'x';
-            else
-                t = '-';
-            switch( alg )
-            {
-                // pawn move ? "e4" or "exf6", plus "=Q" etc if promotion
-                case ALG_PAWN_MOVE:
-                {
-                    if( p == 'P' )
-                    {
-                        done = true;
-                        if( t == 'x' )
-                            sprintf( nmove, "%cx%c%c", FILE(src_),FILE(dst_),RANK(dst_) );
-                        else
-                            sprintf( nmove, "%c%c",FILE(dst_),RANK(dst_) );
-                        char *s = strchr(nmove,'\0');
-                        switch( m.special )
-                        {
-                            case SPECIAL_PROMOTION_QUEEN:
-                                strcpy( s, "=Q" );  break;
-                            case SPECIAL_PROMOTION_ROOK:
-                                strcpy( s, "=R" );  break;
-                            case SPECIAL_PROMOTION_BISHOP:
-                                strcpy( s, "=B" );  break;
-                            case SPECIAL_PROMOTION_KNIGHT:
-                                strcpy( s, "=N" );  break;
-                            default:
-                                break;
-                        }
-                    }
-                    break;
-                }
-
-                // castling ?
-                case ALG_CASTLING:
+        *s++ = (char)toupper(p);
+        if( p!='K' && p!='k' )
+        {
+            Square sources[8];
+            int count = san_sources( cr, p, dst, sources );
+            bool in_check = count>1 && san_in_check( cr );
+            bool other=false, same_file=false, same_rank=false;
+            for( int i=0; i<count; i++ )
+            {
+                Move mv = *this;
+                mv.src = sources[i];
+                if( mv.src!=src && san_legal(cr,mv,in_check) )
                 {
-                    if( m.special==SPECIAL_WK_CASTLING || m.special==SPECIAL_BK_CASTLING )
-                    {
-                        strcpy( nmove, "O-O" );
-                        done = true;
-                    }
-                    else if( m.special==SPECIAL_WQ_CASTLING || m.special==SPECIAL_BQ_CASTLING )
-                    {
-                        strcpy( nmove, "O-O-O" );
-                        done = true;
-                    }
-                    break;
-                }
-
-                // Nd2 or Nxd2
-                case ALG_ND2:
-                {
-                    if( t == 'x' )
-                        sprintf( str_dst, "%cx%c%c", p, FILE(dst_), RANK(dst_) );
-                    else
-                        sprintf( str_dst, "%c%c%c", p, FILE(dst_), RANK(dst_) );
-                    if( i >= 0 )
-                    {
-                        if( 0 == strcmp(nmove,compare) )
-                            matches++;
-                    }
-                    break;
-                }
-
-                // Nbd2 or Nbxd2
-                case ALG_NBD2:
-                {
-                    if( t == 'x' )
-                        sprintf( str_dst, "%c%cx%c%c", p, FILE(src_), FILE(dst_), RANK(dst_) );
-                    else
-                        sprintf( str_dst, "%c%c%c%c", p, FILE(src_), FILE(dst_), RANK(dst_) );
-                    if( i >= 0 )
-                    {
-                        if( 0 == strcmp(nmove,compare) )
-                            matches++;
-                    }
-                    break;
-                }
-
-                // N1d2 or N1xd2
-                case ALG_N1D2:
-                {
-                    if( t == 'x' )
-                        sprintf( str_dst, "%c%cx%c%c", p, RANK(src_), FILE(dst_), RANK(dst_) );
-                    else
-                        sprintf( str_dst, "%c%c%c%c", p, RANK(src_), FILE(dst_), RANK(dst_) );
-                    if( i >= 0 )
-                    {
-                        if( 0 == strcmp(nmove,compare) )
-                            matches++;
-                    }
-                    break;
-                }
-
-                //  Nb1d2 or Nb1xd2
-                case ALG_NB1D2:
-                {
-                    done = true;
-                    if( t == 'x' )
-                        sprintf( nmove, "%c%c%cx%c%c", p, FILE(src_), RANK(src_), FILE(dst_), RANK(dst_) );
-                    else
-                        sprintf( nmove, "%c%c%c%c%c", p, FILE(src_), RANK(src_), FILE(dst_), RANK(dst_) );
-                    break;
+                    other = true;
+                    same_file = same_file || FILE(mv.src)==FILE(src);
+                    same_rank = same_rank || RANK(mv.src)==RANK(src);
                 }
             }
-        }   // end loop for all legal moves with given algorithm
+            if( other && (!same_file || same_rank) )
+                *s++ = FILE(src);
+            if( other && same_file )
+                *s++ = RANK(src);
+        }
+        if( !IsEmptySquare(capture) )
+            *s++ = 'x';
+        *s++ = FILE(dst);
+        *s++ = RANK(dst);
+    }
+    *s = '\0';
 
-        // If it's a looping algorithm and only one move matches nmove, we're done
-        if( do_loop && matches==1 )
-            done = true;
-    }   // end loop for all algorithms
-    if( append )
+    // Reading it back checks the move is legal
+    Move check;
+    if( !check.SanIn(cr,nmove) || check!=*this )
     {
-        char *s = strchr(nmove,'\0');
-        *s++ = append;
+        strcpy( nmove, "--" );
+        return;
+    }
+
+    // Check or mate
+    Move mv = *this;
+    cr->PushMove( mv );
+    if( cr->AttackedPiece( (Square)(cr->white ? cr->wking_square : cr->bking_square) ) )
+    {
+        MOVELIST list;
+        cr->GenLegalMoveList( &list );
+        *s++ = list.count ? '+' : '#';
         *s = '\0';
     }
-    return nmove;
+    cr->PopMove( mv );
 }
 
 /****************************************************************************
@@ -208,6 +208,12 @@ enum TERMINAL
 //             ^                         ^
 //[calculated practical maximum   ] + [margin]
 
+// Longest natural string move with its terminating '\0', eg "Qa1xb2#"
+#define MAXNATURAL 10
+
+// Longest Forsyth string with its terminating '\0', with room for any counts
+#define MAXFORSYTH 128
+
 // We have developed an algorithm to compress any legal chess position,
 //  including who to move, castling allowed flags and enpassant_target
 //  into 24 bytes
@@ -297,6 +303,15 @@ class Move
     // Fast alternative for known good input
     bool NaturalInFast(ChessRules *cr, const char *natural_in);
 
+    // Read standard algebraic notation eg "Nf3", "exd8=Q+"
+    //  return bool okay
+    // The source square comes from the lookup tables for the piece and
+    //  destination, without a move list. Only strict SAN is read, and an
+    //  ambiguous move fails, NaturalIn() reads the looser forms as well.
+    //  Trusted input, like NaturalInFast()'s, is only tested for legality
+    //  to choose between pieces, otherwise every move is proven legal
+    bool SanIn(ChessRules *cr, const char *san, bool trusted = false);
+
     // Read terse string move eg "g1f3"
     //  return bool okay
     bool TerseIn(ChessRules *cr, const char *tmove);
@@ -305,6 +320,10 @@ class Move
     //  eg "Nf3"
     std::string NaturalOut(ChessRules *cr);
 
+    // Convert to natural string in a caller's buffer, without allocating
+    //  eg "Nf3", or "--" if the move isn't legal
+    void NaturalOut(ChessRules *cr, char nmove[MAXNATURAL]);
+
     // Convert to terse string eg "e7e8q"
     std::string TerseOut();
 };
@@ -564,6 +583,10 @@ class ChessPosition : public ChessPositionRaw
     // Publish chess position and supplementary info in forsyth notation
     std::string ForsythPublish();
 
+    // Publish in forsyth notation into a caller's buffer, without allocating
+    //  return length, or 0 (and an empty string) if n is too small
+    size_t ForsythPublish(char *fen, size_t n);
+
     // Compress a ChessPosition into 24 bytes, return 16-bit hash
     unsigned short Compress(CompressedPosition &dst) const;
 
@@ -622,8 +645,13 @@ class ChessRules : public ChessPosition
         history_idx = 1; // prevent bogus repetition draws
         history[0].src =
             a8; // (look backwards through history stops when src==dst)
-        history[0].dst = a8;
-        detail_idx     = 0;
+        history[0].dst    = a8;
+        detail_idx        = 0;
+        hash64_reversible = 0; // nothing earlier to repeat
+#ifdef THC_BITBOARDS
+        BitboardsCalculate();
+#endif
+        Hash64KeyCalculate();
     }
 
     // Copy constructor
@@ -716,12 +744,32 @@ class ChessRules : public ChessPosition
     // Test fundamental internal assumptions and operations
     void TestInternals();
 
+    // 64 bit position key, Hash64Calculate() combined with side to move,
+    //  castling rights and en passant file. Kept up to date by PushMove()
+    //  and PopMove(), call Hash64KeyCalculate() after editing squares[] or
+    //  the details directly (eg after Decompress() or Toggle())
+    uint64_t Hash64Key() const { return hash64_key; }
+    void Hash64KeyCalculate();
+
+#ifdef THC_BITBOARDS
+    // Piece and colour sets, kept in step with squares[] by PushMove() and
+    //  PopMove(). Bit n is Square n. Call BitboardsCalculate() after
+    //  editing squares[] directly (eg after Decompress())
+    void BitboardsCalculate();
+    uint64_t bb_pieces[12]; // indexed by thc::BitboardPiece
+    uint64_t bb_colours[2]; // [0] white men, [1] black men
+#endif
+
     // Private stuff
   protected:
     // Generate a list of all possible moves in a position (including
     //  illegally "moving into check")
     void GenMoveList(MOVELIST *l);
 
+    // Find checking and pinned pieces for the side to move, return a mask
+    //  of squares that resolve a (single) check
+    uint64_t GenCheckAndPinMasks(uint64_t &pinned, uint64_t pin_rays[64]);
+
     // Generate moves for pieces that move along multi-move rays (B,R,Q)
     void LongMoves(MOVELIST *l, Square square, const lte *ptr);
 
@@ -732,6 +780,9 @@ class ChessRules : public ChessPosition
     // Generate list of king moves
     void KingMoves(MOVELIST *l, Square square);
 
+    // Generate castling moves for a king on square
+    void CastlingMoves(MOVELIST *l, Square square);
+
     // Generate list of white pawn moves
     void WhitePawnMoves(MOVELIST *l, Square square);
 
@@ -741,6 +792,15 @@ class ChessRules : public ChessPosition
     // Evaluate a position, returns bool okay (not okay means illegal position)
     bool Evaluate(MOVELIST *list, TERMINAL &score_terminal);
 
+#ifdef THC_BITBOARDS
+    // Flip the bitboard bits a move changes, the same call applies or
+    //  undoes a move. Expects squares[m.src] to hold the moving piece
+    void BitboardsToggle(const Move &m);
+#endif
+
+    // The part of Hash64Key() that isn't the squares
+    uint64_t Hash64StateKey() const;
+
     // ### Data
 
     // Move history is a ring array
@@ -750,6 +810,20 @@ class ChessRules : public ChessPosition
     // Detail stack is a ring array
     DETAIL detail_stack[256]; // must be 256 ..
     unsigned char detail_idx; // .. so this loops around naturally
+
+    // Key, its Hash64StateKey() part and the number of plies since the
+    //  last pawn move or capture (or Init()). Their values before each move
+    //  are on a ring array indexed like the detail stack
+    uint64_t hash64_key;
+    uint64_t hash64_state;
+    int hash64_reversible;
+    struct HASH64_DETAIL
+    {
+        uint64_t key;
+        uint64_t state;
+        int reversible;
+    };
+    HASH64_DETAIL hash64_stack[256];
 };
 
 } // namespace thc
@@ -809,6 +883,11 @@ class ChessEvaluation : public ChessRules
     int planning_score_black_pieces;
     int planning_white_piece_pawn_percent;
     int planning_black_piece_pawn_percent;
+
+    // Set up by Planning(), members rather than statics so that copies
+    //  can be evaluated on different threads
+    int king_ending_bonus_dynamic_white[0x80] = {};
+    int king_ending_bonus_dynamic_black[0x80] = {};
 };
 
 } // namespace thc
@@ -1,6 +1,11 @@
 #include "thc.h"
+#include "archive.h"
+#include "posindex.h"
+#include "../engine/async.h"
+#include <cstddef>
 #include <cstdint>
 #include <stdlib.h>
+#include <vector>
 
 struct thc_move
 {
@@ -21,6 +26,28 @@ struct thc_movelist
     thc_move moves[MAXMOVES];
 };
 
+// the mirrors lay out their fields exactly as thc does (the bit-fields are
+// declared in the same order and widths), so thc can generate moves
+// straight into a caller's thc_movelist
+static_assert(sizeof(thc_move) == sizeof(thc::Move), "move layout differs");
+static_assert(sizeof(thc_movelist) == sizeof(thc::MOVELIST),
+    "move list layout differs");
+static_assert(offsetof(thc_movelist, moves) == offsetof(thc::MOVELIST, moves),
+    "move list layout differs");
+
+static thc::MOVELIST *cast_to_thc_movelist(thc_movelist *list)
+{
+    return reinterpret_cast<thc::MOVELIST *>(list);
+}
+
+static const thc::MOVELIST *cast_to_thc_movelist(const thc_movelist *list)
+{
+    return reinterpret_cast<const thc::MOVELIST *>(list);
+}
+
+#define THC_MAX_FEN 128
+static_assert(THC_MAX_FEN == MAXFORSYTH, "fen lengths must match");
+
 typedef enum thc_game_ends
 {
     GAME_NOT_ENDED      = 0,
@@ -34,12 +61,84 @@ typedef enum thc_game_ends
 
 // extern "C" thc_move thc_move_init();
 extern "C" thc_board *thc_board_init();
+extern "C" thc_board *thc_board_init_fen(const char *fen);
 extern "C" void thc_board_destroy(thc_board *);
+extern "C" bool thc_board_from_fen(thc_board *, const char *fen);
+extern "C" size_t thc_board_to_fen(thc_board *, char *buf, size_t n);
 extern "C" void thc_board_gen_legal_move_list(thc_board *, thc_movelist *);
 extern "C" void thc_board_play_move(thc_board *, thc_move);
 extern "C" bool thc_board_is_white_move(thc_board *);
 extern "C" char *thc_board_get_squares(thc_board *); // do not edit the string
 extern "C" thc_game_ends thc_board_get_game_end(thc_board *);
+extern "C" void thc_board_perft(thc_board *, int depth, uint64_t *nodes);
+extern "C" void thc_board_perft_divide(
+    thc_board *, int depth, thc_movelist *moves, uint64_t *nodes);
+
+struct thc_archive
+{
+    thc::ArchiveWriter writer;
+    std::vector<uint8_t> moves; // the game being recorded
+};
+
+extern "C" thc_archive *thc_archive_create(const char *path);
+extern "C" bool thc_archive_add_move(
+    thc_archive *, const thc_movelist *legal, thc_move);
+extern "C" bool thc_archive_end_game(thc_archive *, thc_game_ends);
+extern "C" bool thc_archive_close(thc_archive *);
+
+struct thc_position_index
+{
+    thc::PositionIndex index;
+};
+
+typedef struct thc_position_stats
+{
+    uint32_t games;
+    uint32_t white_wins;
+    uint32_t black_wins;
+    uint32_t draws;
+} thc_position_stats;
+
+extern "C" thc_position_index *thc_position_index_open(const char *path);
+extern "C" void thc_position_index_close(thc_position_index *);
+extern "C" size_t thc_position_index_find(
+    thc_position_index *, thc_board *, thc_position_stats *stats,
+    uint64_t *games, size_t max);
+
+typedef struct thc_search_budget
+{
+    uint32_t time_ms;
+    uint64_t nodes;
+    int depth;
+} thc_search_budget;
+
+extern "C" thc_move thc_board_best_move(thc_board *, thc_search_budget);
+extern "C" void thc_set_hash_size(uint32_t megabytes);
+extern "C" void thc_set_search_threads(int threads);
+
+struct thc_engine
+{
+    explicit thc_engine(Engine::TranspositionTable *tt) : search(tt) {}
+    Engine::AsyncSearch search;
+};
+
+#define THC_MAX_PV 64
+static_assert(THC_MAX_PV == Engine::MAX_PLY, "pv lengths must match");
+typedef struct thc_search_info
+{
+    thc_move best;
+    int score;
+    int depth;
+    uint64_t nodes;
+    int pv_length;
+    thc_move pv[THC_MAX_PV];
+} thc_search_info;
+
+extern "C" thc_engine *thc_engine_init();
+extern "C" void thc_engine_destroy(thc_engine *);
+extern "C" void thc_engine_start(thc_engine *, thc_board *, thc_search_budget);
+extern "C" void thc_engine_stop(thc_engine *);
+extern "C" bool thc_engine_poll(thc_engine *, thc_search_info *info);
 // thc move helper
 thc::Move cast_to_thc_move(thc_move m)
 {
@@ -71,21 +170,33 @@ thc_board *thc_board_init()
     return b;
 }
 
-void thc_board_destroy(thc_board *b) { free(b); }
+thc_board *thc_board_init_fen(const char *fen)
+{
+    thc_board *b = thc_board_init();
+    if (!thc_board_from_fen(b, fen))
+    {
+        thc_board_destroy(b);
+        return NULL;
+    }
+    return b;
+}
 
-#include <cassert>
+void thc_board_destroy(thc_board *b) { free(b); }
 
-void thc_board_gen_legal_move_list(thc_board *b, thc_movelist *list)
+bool thc_board_from_fen(thc_board *b, const char *fen)
 {
+    // Forsyth() checks the whole string before it changes anything
+    return b->internal_board.Forsyth(fen);
+}
 
-    thc::MOVELIST thc_list;
-    b->internal_board.GenLegalMoveList(&thc_list);
-    list->count = thc_list.count;
-    for (size_t i = 0; i < thc_list.count; i++)
-        list->moves[i] = cast_from_thc_move(thc_list.moves[i]);
+size_t thc_board_to_fen(thc_board *b, char *buf, size_t n)
+{
+    return b->internal_board.ForsythPublish(buf, n);
+}
 
-    for (size_t i = 0; i < thc_list.count; i++)
-        assert(thc_list.moves[i].src == list->moves[i].src);
+void thc_board_gen_legal_move_list(thc_board *b, thc_movelist *list)
+{
+    b->internal_board.GenLegalMoveList(cast_to_thc_movelist(list));
 }
 
 void thc_board_play_move(thc_board *b, thc_move m)
@@ -129,4 +240,206 @@ thc_game_ends thc_board_get_game_end(thc_board *b)
     }
 
     return GAME_NOT_ENDED;
-}
\ No newline at end of file
+}
+
+// counts leaves at depth 1 straight from the move list (bulk counting)
+static uint64_t perft(thc::ChessRules &cr, int depth)
+{
+    if (depth <= 0)
+        return 1;
+
+    thc::MOVELIST list;
+    cr.GenLegalMoveList(&list);
+    if (depth == 1)
+        return list.count;
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < list.count; i++)
+    {
+        cr.PushMove(list.moves[i]);
+        nodes += perft(cr, depth - 1);
+        cr.PopMove(list.moves[i]);
+    }
+    return nodes;
+}
+
+void thc_board_perft(thc_board *b, int depth, uint64_t *nodes)
+{
+    *nodes = perft(b->internal_board, depth);
+}
+
+void thc_board_perft_divide(
+    thc_board *b, int depth, thc_movelist *moves, uint64_t *nodes)
+{
+    thc::ChessRules &cr     = b->internal_board;
+    thc::MOVELIST *thc_list = cast_to_thc_movelist(moves);
+    cr.GenLegalMoveList(thc_list);
+    for (int i = 0; i < thc_list->count; i++)
+    {
+        cr.PushMove(thc_list->moves[i]);
+        nodes[i] = perft(cr, depth - 1);
+        cr.PopMove(thc_list->moves[i]);
+    }
+}
+
+thc_archive *thc_archive_create(const char *path)
+{
+    thc_archive *a = new thc_archive;
+    if (!a->writer.Open(path))
+    {
+        delete a;
+        return NULL;
+    }
+    return a;
+}
+
+bool thc_archive_add_move(
+    thc_archive *a, const thc_movelist *legal, thc_move m)
+{
+    thc::Move move = cast_to_thc_move(m);
+    int index      = thc::ArchiveMoveIndex(*cast_to_thc_movelist(legal), move);
+    if (index < 0 || a->moves.size() >= thc::ARCHIVE_MAX_PLIES)
+        return false;
+    a->moves.push_back((uint8_t)index);
+    return true;
+}
+
+static thc::ArchiveResult cast_to_archive_result(thc_game_ends end)
+{
+    switch (end)
+    {
+    case GAME_NOT_ENDED: return thc::ARCHIVE_UNFINISHED;
+    case GAME_END_WCHECKMATE: return thc::ARCHIVE_BLACK_WINS;
+    case GAME_END_BCHECKMATE: return thc::ARCHIVE_WHITE_WINS;
+    default: return thc::ARCHIVE_DRAW;
+    }
+}
+
+bool thc_archive_end_game(thc_archive *a, thc_game_ends end)
+{
+    if (a->moves.empty())
+        return true;
+    bool ok = a->writer.Write(
+        a->moves.data(), a->moves.size(), cast_to_archive_result(end));
+    a->moves.clear();
+    return ok;
+}
+
+bool thc_archive_close(thc_archive *a)
+{
+    bool ok = a->writer.Close();
+    delete a;
+    return ok;
+}
+
+thc_position_index *thc_position_index_open(const char *path)
+{
+    thc_position_index *p = new thc_position_index;
+    if (!p->index.Open(path))
+    {
+        delete p;
+        return NULL;
+    }
+    return p;
+}
+
+void thc_position_index_close(thc_position_index *p) { delete p; }
+
+size_t thc_position_index_find(
+    thc_position_index *p, thc_board *b, thc_position_stats *stats,
+    uint64_t *games, size_t max)
+{
+    thc::PositionStats found;
+    uint64_t first;
+    if (!p->index.Find(b->internal_board, found, first))
+    {
+        *stats = (thc_position_stats){};
+        return 0;
+    }
+    stats->games      = found.games;
+    stats->white_wins = found.whiteWins;
+    stats->black_wins = found.blackWins;
+    stats->draws      = found.draws;
+
+    size_t n = found.games < max ? found.games : max;
+    for (size_t i = 0; i < n; i++)
+        games[i] = p->index.Game(first, (uint32_t)i);
+    return n;
+}
+
+// kept between searches so later moves reuse earlier work
+static Engine::TranspositionTable &transposition_table()
+{
+    static Engine::TranspositionTable tt;
+    return tt;
+}
+
+static int search_threads = 0; // 0 for one per hardware thread
+
+static int thread_count()
+{
+    return search_threads ? search_threads : Engine::DefaultThreadCount();
+}
+
+static Engine::SearchLimits cast_to_search_limits(thc_search_budget budget)
+{
+    Engine::SearchLimits limits;
+    limits.timeMs = budget.time_ms;
+    limits.nodes  = budget.nodes;
+    limits.depth  = budget.depth;
+    return limits;
+}
+
+thc_move thc_board_best_move(thc_board *b, thc_search_budget budget)
+{
+    Engine::SearchLimits limits = cast_to_search_limits(budget);
+
+    Engine::TranspositionTable &tt = transposition_table();
+    tt.NewSearch();
+    Engine::ParallelSearch search(b->internal_board, &tt, thread_count());
+    Engine::SearchResult result = search.Run(limits);
+    return cast_from_thc_move(result.best);
+}
+
+void thc_set_hash_size(uint32_t megabytes)
+{
+    transposition_table().Resize(megabytes);
+}
+
+void thc_set_search_threads(int threads)
+{
+    search_threads = threads > 0 ? threads : 0;
+}
+
+thc_engine *thc_engine_init()
+{
+    return new thc_engine(&transposition_table());
+}
+
+void thc_engine_destroy(thc_engine *e) { delete e; }
+
+void thc_engine_start(thc_engine *e, thc_board *b, thc_search_budget budget)
+{
+    e->search.Start(
+        b->internal_board, cast_to_search_limits(budget), thread_count());
+}
+
+void thc_engine_stop(thc_engine *e) { e->search.Stop(); }
+
+bool thc_engine_poll(thc_engine *e, thc_search_info *info)
+{
+    // read finished first, so a finished search's snapshot is its last
+    bool finished = e->search.Finished();
+
+    Engine::SearchResult result;
+    if (!e->search.Snapshot(result))
+        result.best.Invalid();
+    info->best      = cast_from_thc_move(result.best);
+    info->score     = result.score;
+    info->depth     = result.depth;
+    info->nodes     = result.nodes;
+    info->pv_length = result.pvLength;
+    for (int i = 0; i < result.pvLength; i++)
+        info->pv[i] = cast_from_thc_move(result.pv[i]);
+    return finished;
+}
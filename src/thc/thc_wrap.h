@@ -46,8 +46,8 @@ typedef enum thc_special
 typedef enum thc_game_ends
 {
     GAME_NOT_ENDED      = 0,
-    GAME_END_WCHECKMATE = 1,
-    GAME_END_BCHECKMATE = -1,
+    GAME_END_WCHECKMATE = 1,  // white is checkmated
+    GAME_END_BCHECKMATE = -1, // black is checkmated
     GAME_END_STALEMATE  = 2,
     GAME_END_INSUFFICIENT,
     GAME_END_REPITITION,
@@ -89,9 +89,103 @@ typedef struct thc_movelist
 typedef struct thc_board thc_board;
 
 thc_board *thc_board_init();
+thc_board *thc_board_init_fen(const char *fen); // NULL if fen is invalid
 void thc_board_destroy(thc_board *);
+
+// FEN without allocating, for loading positions in bulk
+// a FEN and its terminating '\0' always fit in THC_MAX_FEN chars
+#define THC_MAX_FEN 128
+// set up the board from fen, false (the board unchanged) if it's invalid
+bool thc_board_from_fen(thc_board *, const char *fen);
+// write the board's FEN to buf, returns its length or 0 if n is too small
+size_t thc_board_to_fen(thc_board *, char *buf, size_t n);
+
 void thc_board_gen_legal_move_list(thc_board *, thc_movelist *);
 void thc_board_play_move(thc_board *, thc_move);
 bool thc_board_is_white_move(thc_board *);
 char *thc_board_get_squares(thc_board *);          // do not edit the string
 thc_game_ends thc_board_get_game_end(thc_board *); // GAME_NOT_ENDED, or end
+
+// count the leaf nodes of the legal move tree to depth
+void thc_board_perft(thc_board *, int depth, uint64_t *nodes);
+// perft split by root move, nodes[i] is the count below moves->moves[i]
+void thc_board_perft_divide(
+    thc_board *, int depth, thc_movelist *moves, uint64_t *nodes);
+
+// games recorded in a binary archive, about a byte a move (see archive.h)
+// every game starts from the standard position
+typedef struct thc_archive thc_archive;
+
+thc_archive *thc_archive_create(const char *path); // NULL if it can't be
+// record the game's next move, before it is played. legal is the position's
+// legal move list. false if the move isn't in it or the game is too long
+bool thc_archive_add_move(thc_archive *, const thc_movelist *legal, thc_move);
+// write the recorded game with its end, GAME_NOT_ENDED for an unfinished
+// game. a game with no moves isn't written. false if writing fails
+bool thc_archive_end_game(thc_archive *, thc_game_ends);
+// fill in the game count and free the archive, false if anything failed to
+// write. a game still being recorded is lost
+bool thc_archive_close(thc_archive *);
+
+// the games reaching positions, from an index file (see posindex.h)
+// the file is mapped rather than read, so it can be any size
+typedef struct thc_position_index thc_position_index;
+
+typedef struct thc_position_stats
+{
+    uint32_t games; // including unfinished games
+    uint32_t white_wins;
+    uint32_t black_wins;
+    uint32_t draws;
+} thc_position_stats;
+
+thc_position_index *thc_position_index_open(const char *path); // NULL if bad
+void thc_position_index_close(thc_position_index *);
+// results of the games reaching the board's position, and the ids of the
+// first max of them in games. returns the number of ids written
+size_t thc_position_index_find(
+    thc_position_index *, thc_board *, thc_position_stats *stats,
+    uint64_t *games, size_t max);
+
+// limits for a best move search, zero fields are not limited
+typedef struct thc_search_budget
+{
+    uint32_t time_ms;
+    uint64_t nodes;
+    int depth;
+} thc_search_budget;
+
+// search for the best move for the side to play
+// returns a move with src == dst if there are no legal moves
+thc_move thc_board_best_move(thc_board *, thc_search_budget);
+
+// size of the transposition table kept between searches, default 16 MB
+// clears the table, don't call while a search is running
+void thc_set_hash_size(uint32_t megabytes);
+
+// threads used by each search, 0 (the default) for one per hardware thread
+void thc_set_search_threads(int threads);
+
+// a search running on a background thread, start and stop it from one
+// thread, poll it from any
+typedef struct thc_engine thc_engine;
+
+#define THC_MAX_PV 64
+typedef struct thc_search_info
+{
+    thc_move best; // src == dst until the first iteration completes
+    int score;     // side to move, 40 a pawn, mate near +-1000000
+    int depth;
+    uint64_t nodes;
+    int pv_length;
+    thc_move pv[THC_MAX_PV];
+} thc_search_info;
+
+thc_engine *thc_engine_init();
+void thc_engine_destroy(thc_engine *); // stops and waits for the search
+// searches a copy of the board, stopping any search already running
+void thc_engine_start(thc_engine *, thc_board *, thc_search_budget);
+void thc_engine_stop(thc_engine *); // returns without waiting
+// fills info with the latest result, returns true once the search is done
+// never blocks
+bool thc_engine_poll(thc_engine *, thc_search_info *info);
@@ -0,0 +1,206 @@
+// FEN benchmark for the C wrapper
+//
+// times thc_board_from_fen() and thc_board_to_fen() over a set of positions,
+// reporting FENs per second, and checks every FEN reads back the same. the
+// positions come from random games played from the start, or from a FEN or
+// EPD file with a position a line (EPD operations are ignored)
+//
+// usage:
+//   fenbench.out [options] [file]
+//     --positions <n>   random positions to collect, default 100000
+//     --rounds <n>      times through the positions, default 10
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../thc/thc_wrap.h"
+
+typedef char Fen[THC_MAX_FEN];
+
+static double seconds_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// positions from games of random moves, restarting when a game ends
+static Fen *random_positions(size_t count)
+{
+    Fen *fens = malloc(count * sizeof(Fen));
+    if (fens == NULL)
+        return NULL;
+
+    uint64_t seed = 1;
+    thc_board *b  = thc_board_init();
+    thc_movelist list;
+    for (size_t i = 0; i < count; i++)
+    {
+        thc_board_gen_legal_move_list(b, &list);
+        if (list.count == 0 || thc_board_get_game_end(b) != GAME_NOT_ENDED)
+        {
+            thc_board_destroy(b);
+            b = thc_board_init();
+            thc_board_gen_legal_move_list(b, &list);
+        }
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        thc_board_play_move(b, list.moves[(seed >> 33) % list.count]);
+        thc_board_to_fen(b, fens[i], sizeof(Fen));
+    }
+    thc_board_destroy(b);
+    return fens;
+}
+
+// a line cut down to its FEN fields, EPD has no counts so they are added
+static void trim_to_fen(char *line)
+{
+    int field = 0;
+    for (char *p = line; *p; p++)
+    {
+        if (*p != ' ' && (p == line || p[-1] == ' '))
+        {
+            if (field == 6 || (field >= 4 && (*p < '0' || *p > '9')))
+            {
+                p[-1] = '\0';
+                break;
+            }
+            field++;
+        }
+    }
+    if (field == 4)
+        strcat(line, " 0 1");
+}
+
+static Fen *file_positions(const char *path, size_t *count)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return NULL;
+
+    size_t capacity = 1024;
+    Fen *fens       = malloc(capacity * sizeof(Fen));
+    char line[1024];
+    *count = 0;
+    while (fens && fgets(line, sizeof(line), file))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        trim_to_fen(line);
+        if (line[0] == '\0' || strlen(line) >= sizeof(Fen))
+            continue;
+
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            Fen *grown = realloc(fens, capacity * sizeof(Fen));
+            if (grown == NULL)
+                free(fens);
+            fens = grown;
+            if (fens == NULL)
+                break;
+        }
+        strcpy(fens[(*count)++], line);
+    }
+    fclose(file);
+    return fens;
+}
+
+int main(int argc, char **argv)
+{
+    size_t count     = 100000;
+    int rounds       = 10;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--positions") == 0 && i + 1 < argc)
+            count = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+            rounds = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && path == NULL)
+            path = argv[i];
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (rounds < 1)
+        rounds = 1;
+
+    Fen *fens = path ? file_positions(path, &count) : random_positions(count);
+    if (fens == NULL)
+    {
+        fprintf(stderr, "can't read positions%s%s\n", path ? " from " : "",
+                path ? path : "");
+        return 1;
+    }
+
+    // FENs that don't parse are reported and left out of the timings
+    thc_board *b    = thc_board_init();
+    size_t valid    = 0;
+    size_t invalid  = 0;
+    size_t mismatch = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        Fen first, second;
+        if (!thc_board_from_fen(b, fens[i]))
+        {
+            if (invalid++ < 10)
+                printf("invalid fen '%s'\n", fens[i]);
+            continue;
+        }
+        thc_board_to_fen(b, first, sizeof(first));
+        thc_board_from_fen(b, first);
+        thc_board_to_fen(b, second, sizeof(second));
+        if (strcmp(first, second) != 0 && mismatch++ < 10)
+            printf("'%s' reads back as '%s'\n", first, second);
+        if (valid != i)
+            strcpy(fens[valid], fens[i]);
+        valid++;
+    }
+
+    // publishing needs a board set up, so it is timed as the difference
+    // between parsing alone and parsing then publishing
+    size_t length = 0;
+    double start  = seconds_now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < valid; i++)
+            thc_board_from_fen(b, fens[i]);
+    }
+    double parse = seconds_now() - start;
+
+    start = seconds_now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < valid; i++)
+        {
+            Fen out;
+            thc_board_from_fen(b, fens[i]);
+            length += thc_board_to_fen(b, out, sizeof(out));
+        }
+    }
+    double both    = seconds_now() - start;
+    double publish = both > parse ? both - parse : 0;
+    double total   = (double)valid * rounds;
+
+    printf(
+        "%zu positions x %d rounds, %zu invalid, %zu don't read back\n"
+        "parse   %8.3fs %12.0f fens/s\n"
+        "publish %8.3fs %12.0f fens/s\n"
+        "average length %.1f\n",
+        valid,
+        rounds,
+        invalid,
+        mismatch,
+        parse,
+        parse > 0 ? total / parse : 0,
+        publish,
+        publish > 0 ? total / publish : 0,
+        total > 0 ? length / total : 0);
+
+    thc_board_destroy(b);
+    free(fens);
+    return invalid != 0 || mismatch != 0;
+}
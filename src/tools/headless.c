@@ -0,0 +1,332 @@
+// the game without a window, for servers with no display
+//
+// reads one command a line from stdin and answers on stdout, so games can be
+// played by a script or over a pipe. the computer answers the player's moves
+// like the windowed game does
+//
+// usage:
+//   chess_2_headless.out [options]
+//     --computer white|black|none   side the computer plays, default black
+//     --time <ms>                   thinking time a move, default 1000
+//     --hash <mb>                   search memory, default 16
+//     --threads <n>                 search threads, default one per core
+//     --archive <file>              record the games played to a binary
+//                                   archive, see src/thc/archive.h
+//     --positions <index>           a position index for the games
+//                                   command, see src/thc/posindex.h
+//
+// commands:
+//   new          start a new game
+//   board        print the board, white at the bottom
+//   moves        list the legal moves
+//   e2e4, e7e8q  play a move in coordinate notation
+//   games        results of the indexed games that reached the position,
+//                and the archive offsets of the first few
+//   go           the computer plays a move for the side to play
+//   auto         the computer plays both sides until the game ends
+//   quit
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../move.h"
+
+typedef enum Computer
+{
+    COMPUTER_NONE,
+    COMPUTER_WHITE,
+    COMPUTER_BLACK,
+} Computer;
+
+// where games are recorded, NULL if they aren't
+static ChessArchive *archive = NULL;
+
+// games listed by the games command
+#define MAX_LISTED_GAMES 10
+
+// write a move in coordinate notation, eg "e7e8q"
+static void move_to_str(ChessMove m, char str[6])
+{
+    str[0] = 'a' + get_file(m.src);
+    str[1] = '8' - get_rank(m.src);
+    str[2] = 'a' + get_file(m.dst);
+    str[3] = '8' - get_rank(m.dst);
+    str[4] = '\0';
+    switch (m.special)
+    {
+    case SPECIAL_PROMOTION_QUEEN: str[4] = 'q'; break;
+    case SPECIAL_PROMOTION_ROOK: str[4] = 'r'; break;
+    case SPECIAL_PROMOTION_BISHOP: str[4] = 'b'; break;
+    case SPECIAL_PROMOTION_KNIGHT: str[4] = 'n'; break;
+    default: break;
+    }
+    str[5] = '\0';
+}
+
+// find the legal move written as str, false if there isn't one
+// a promotion with no piece given is to a queen
+static bool parse_move(const ChessBoard *b, const char *str, ChessMove *move)
+{
+    if (strlen(str) < 4 || str[0] < 'a' || str[0] > 'h' || str[1] < '1' ||
+        str[1] > '8' || str[2] < 'a' || str[2] > 'h' || str[3] < '1' ||
+        str[3] > '8')
+        return false;
+
+    ChessSquare src = make_square(str[0] - 'a', '8' - str[1]);
+    ChessSquare dst = make_square(str[2] - 'a', '8' - str[3]);
+    char promotion  = str[4] ? str[4] : 'q';
+
+    ChessMoveList list;
+    chess_board_gen_movelist(b, &list);
+    for (int i = 0; i < list.count; i++)
+    {
+        ChessMove m = list.moves[i];
+        if (m.src != src || m.dst != dst)
+            continue;
+
+        char written[6];
+        move_to_str(m, written);
+        if (written[4] == '\0' || written[4] == promotion)
+        {
+            *move = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *game_end_str(ChessGameEnds end)
+{
+    switch (end)
+    {
+    case GAME_END_WCHECKMATE: return "0-1 {black mates}";
+    case GAME_END_BCHECKMATE: return "1-0 {white mates}";
+    case GAME_END_STALEMATE: return "1/2-1/2 {stalemate}";
+    case GAME_END_INSUFFICIENT: return "1/2-1/2 {insufficient material}";
+    case GAME_END_REPITITION: return "1/2-1/2 {repetition}";
+    case GAME_END_50_MOVE: return "1/2-1/2 {50 move rule}";
+    default: return "*";
+    }
+}
+
+static void print_board(const ChessBoard *b)
+{
+    const char *squares = chess_board_get_squares(b);
+    for (int rank = 0; rank < 8; rank++)
+    {
+        printf("%d ", 8 - rank);
+        for (int file = 0; file < 8; file++)
+        {
+            char c = squares[rank * 8 + file];
+            printf(" %c", c == ' ' ? '.' : c);
+        }
+        printf("\n");
+    }
+    printf("\n   a b c d e f g h\n");
+    printf("%s to play\n", chess_board_white_to_play(b) ? "white" : "black");
+}
+
+static void print_moves(const ChessBoard *b)
+{
+    ChessMoveList list;
+    chess_board_gen_movelist(b, &list);
+    for (int i = 0; i < list.count; i++)
+    {
+        char str[6];
+        move_to_str(list.moves[i], str);
+        printf(i ? " %s" : "%s", str);
+    }
+    printf("\n");
+}
+
+// play a move and report it, false once the game has ended
+static bool play(const ChessBoard *b, ChessMove m, const char *who)
+{
+    char str[6];
+    move_to_str(m, str);
+    if (archive)
+        chess_archive_add_move(archive, b, m);
+    chess_board_move(b, m);
+    printf("%s %s\n", who, str);
+
+    ChessGameEnds end = chess_board_get_game_end(b);
+    if (end != GAME_NOT_ENDED)
+    {
+        if (archive)
+            chess_archive_end_game(archive, b);
+        printf("result %s\n", game_end_str(end));
+        return false;
+    }
+    return true;
+}
+
+// the computer plays a move, false if the game is over
+static bool computer_move(const ChessBoard *b, ChessSearchBudget budget)
+{
+    if (chess_board_get_game_end(b) != GAME_NOT_ENDED)
+    {
+        printf("result %s\n", game_end_str(chess_board_get_game_end(b)));
+        return false;
+    }
+    return play(b, chess_board_best_move(b, budget), "computer");
+}
+
+static void print_games(ChessPositionIndex *positions, const ChessBoard *b)
+{
+    if (positions == NULL)
+    {
+        printf("error no position index, start with --positions\n");
+        return;
+    }
+
+    ChessPositionStats stats;
+    uint64_t games[MAX_LISTED_GAMES];
+    size_t n = chess_position_index_find(
+        positions, b, &stats, games, MAX_LISTED_GAMES);
+    printf(
+        "games %u white %u black %u draws %u\n",
+        stats.games,
+        stats.white_wins,
+        stats.black_wins,
+        stats.draws);
+    for (size_t i = 0; i < n; i++)
+        printf(i ? " %llu" : "%llu", (unsigned long long)games[i]);
+    if (n)
+        printf("\n");
+}
+
+static bool computers_turn(const ChessBoard *b, Computer computer)
+{
+    bool white = chess_board_white_to_play(b);
+    return (computer == COMPUTER_WHITE && white) ||
+           (computer == COMPUTER_BLACK && !white);
+}
+
+int main(int argc, char **argv)
+{
+    Computer computer             = COMPUTER_BLACK;
+    ChessSearchBudget budget      = {.time_ms = 1000};
+    ChessPositionIndex *positions = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg   = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL)
+        {
+            fprintf(stderr, "%s needs a value\n", arg);
+            return 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--computer") == 0)
+            computer = strcmp(value, "white") == 0   ? COMPUTER_WHITE
+                       : strcmp(value, "black") == 0 ? COMPUTER_BLACK
+                                                     : COMPUTER_NONE;
+        else if (strcmp(arg, "--time") == 0)
+        {
+            // a zero budget is no limit, with no depth limit either the
+            // computer would never answer
+            int ms = atoi(value);
+            if (ms <= 0)
+            {
+                fprintf(stderr, "--time must be at least 1 ms\n");
+                return 1;
+            }
+            budget.time_ms = ms;
+        }
+        else if (strcmp(arg, "--hash") == 0)
+            chess_set_hash_size(atoi(value));
+        else if (strcmp(arg, "--threads") == 0)
+            chess_set_search_threads(atoi(value));
+        else if (strcmp(arg, "--archive") == 0)
+        {
+            archive = chess_archive_create(value);
+            if (archive == NULL)
+            {
+                fprintf(stderr, "can't create %s\n", value);
+                return 1;
+            }
+        }
+        else if (strcmp(arg, "--positions") == 0)
+        {
+            positions = chess_position_index_open(value);
+            if (positions == NULL)
+            {
+                fprintf(stderr, "can't read %s\n", value);
+                return 1;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return 1;
+        }
+    }
+
+    // answered a line at a time, a script waits on each reply
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    ChessBoard *b = chess_board_init();
+    if (computers_turn(b, computer))
+        computer_move(b, budget);
+
+    char line[256];
+    while (fgets(line, sizeof(line), stdin))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0')
+            continue;
+
+        ChessMove move;
+        if (strcmp(line, "quit") == 0)
+            break;
+        else if (strcmp(line, "new") == 0)
+        {
+            // a game left unfinished is still recorded
+            if (archive)
+                chess_archive_end_game(archive, b);
+            chess_board_destroy(b);
+            b = chess_board_init();
+            if (computers_turn(b, computer))
+                computer_move(b, budget);
+        }
+        else if (strcmp(line, "board") == 0)
+            print_board(b);
+        else if (strcmp(line, "moves") == 0)
+            print_moves(b);
+        else if (strcmp(line, "games") == 0)
+            print_games(positions, b);
+        else if (strcmp(line, "go") == 0)
+            computer_move(b, budget);
+        else if (strcmp(line, "auto") == 0)
+        {
+            while (computer_move(b, budget))
+                ;
+        }
+        else if (chess_board_get_game_end(b) != GAME_NOT_ENDED)
+            printf("error game over, send new\n");
+        else if (parse_move(b, line, &move))
+        {
+            if (play(b, move, "player") && computers_turn(b, computer))
+                computer_move(b, budget);
+        }
+        else
+            printf("error unknown command or illegal move '%s'\n", line);
+    }
+
+    if (positions)
+        chess_position_index_close(positions);
+    if (archive)
+    {
+        chess_archive_end_game(archive, b);
+        if (!chess_archive_close(archive))
+        {
+            fprintf(stderr, "writing the archive failed\n");
+            chess_board_destroy(b);
+            return 1;
+        }
+    }
+    chess_board_destroy(b);
+    return 0;
+}
@@ -0,0 +1,178 @@
+// perft benchmark for the thc move generator
+//
+// counts the leaf nodes of the legal move tree for a suite of standard
+// positions, checking them against the published counts and reporting
+// nodes per second
+//
+// usage:
+//   perft.out [max depth]
+//   perft.out <depth> "<fen>"           (prints divide output)
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../thc/thc_wrap.h"
+
+#define PERFT_MAX_DEPTH 6
+
+typedef struct PerftPosition
+{
+    const char *name;
+    const char *fen;
+    // expected node counts for depth 1 to PERFT_MAX_DEPTH, 0 if unknown
+    uint64_t nodes[PERFT_MAX_DEPTH];
+} PerftPosition;
+
+// https://www.chessprogramming.org/Perft_Results
+static const PerftPosition suite[] = {
+    {"start",
+     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+     {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"kiwipete",
+     "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     {48, 2039, 97862, 4085603, 193690690, 0}},
+    {"position 3",
+     "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     {14, 191, 2812, 43238, 674624, 11030083}},
+    {"position 4",
+     "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     {6, 264, 9467, 422333, 15833292, 0}},
+    {"position 5",
+     "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     {44, 1486, 62379, 2103487, 89941194, 0}},
+    {"position 6",
+     "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 "
+     "10",
+     {46, 2079, 89890, 3894594, 164075551, 0}},
+};
+
+static double seconds_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// write a move in coordinate notation, eg "e7e8q"
+static void move_to_str(thc_move m, char str[6])
+{
+    str[0] = 'a' + get_file(m.src);
+    str[1] = '8' - get_rank(m.src);
+    str[2] = 'a' + get_file(m.dst);
+    str[3] = '8' - get_rank(m.dst);
+    str[4] = '\0';
+    switch (m.special)
+    {
+    case SPECIAL_PROMOTION_QUEEN: str[4] = 'q'; break;
+    case SPECIAL_PROMOTION_ROOK: str[4] = 'r'; break;
+    case SPECIAL_PROMOTION_BISHOP: str[4] = 'b'; break;
+    case SPECIAL_PROMOTION_KNIGHT: str[4] = 'n'; break;
+    default: break;
+    }
+    str[5] = '\0';
+}
+
+static int divide(const char *fen, int depth)
+{
+    thc_board *b = thc_board_init_fen(fen);
+    if (b == NULL)
+    {
+        printf("Invalid fen '%s'\n", fen);
+        return 1;
+    }
+
+    thc_movelist moves;
+    uint64_t nodes[MAXMOVES];
+    double start = seconds_now();
+    thc_board_perft_divide(b, depth, &moves, nodes);
+    double elapsed = seconds_now() - start;
+
+    uint64_t total = 0;
+    for (int i = 0; i < moves.count; i++)
+    {
+        char str[6];
+        move_to_str(moves.moves[i], str);
+        printf("%s: %llu\n", str, (unsigned long long)nodes[i]);
+        total += nodes[i];
+    }
+    printf(
+        "\nmoves: %d\nnodes: %llu\ntime: %.3fs\nnps: %.0f\n",
+        moves.count,
+        (unsigned long long)total,
+        elapsed,
+        elapsed > 0 ? total / elapsed : 0);
+
+    thc_board_destroy(b);
+    return 0;
+}
+
+static int run_suite(int max_depth)
+{
+    uint64_t total_nodes = 0;
+    double total_time    = 0;
+    int failures         = 0;
+
+    for (size_t i = 0; i < sizeof(suite) / sizeof(suite[0]); i++)
+    {
+        thc_board *b = thc_board_init_fen(suite[i].fen);
+        if (b == NULL)
+        {
+            printf("%-12s invalid fen\n", suite[i].name);
+            failures++;
+            continue;
+        }
+
+        for (int depth = 1; depth <= max_depth; depth++)
+        {
+            uint64_t expected = suite[i].nodes[depth - 1];
+            if (expected == 0)
+                break;
+
+            uint64_t nodes;
+            double start = seconds_now();
+            thc_board_perft(b, depth, &nodes);
+            double elapsed = seconds_now() - start;
+
+            total_nodes += nodes;
+            total_time += elapsed;
+
+            bool ok = nodes == expected;
+            failures += !ok;
+            printf(
+                "%-12s depth %d %12llu nodes %8.3fs %12.0f nps %s\n",
+                suite[i].name,
+                depth,
+                (unsigned long long)nodes,
+                elapsed,
+                elapsed > 0 ? nodes / elapsed : 0,
+                ok ? "ok" : "FAILED");
+            if (!ok)
+                printf("    expected %llu\n", (unsigned long long)expected);
+        }
+
+        thc_board_destroy(b);
+    }
+
+    printf(
+        "\ntotal %llu nodes %.3fs %.0f nps, %d failures\n",
+        (unsigned long long)total_nodes,
+        total_time,
+        total_time > 0 ? total_nodes / total_time : 0,
+        failures);
+    return failures != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int depth = argc > 1 ? atoi(argv[1]) : 4;
+    if (depth < 1)
+        depth = 1;
+
+    if (argc > 2)
+        return divide(argv[2], depth);
+
+    if (depth > PERFT_MAX_DEPTH)
+        depth = PERFT_MAX_DEPTH;
+    return run_suite(depth);
+}
@@ -0,0 +1,271 @@
+#include "pgn.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Pgn
+{
+
+namespace
+{
+
+bool IsSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// ends a movetext token
+bool IsDelimiter(char c)
+{
+    return IsSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' ||
+           c == ';';
+}
+
+bool IsDigit(char c) { return '0' <= c && c <= '9'; }
+
+// the '\n' ending p's line, or end
+const char *LineEnd(const char *p, const char *end)
+{
+    const char *newline = (const char *)memchr(p, '\n', end - p);
+    return newline ? newline : end;
+}
+
+const char *NextLine(const char *p, const char *end)
+{
+    p = LineEnd(p, end);
+    return p < end ? p + 1 : end;
+}
+
+const char *SkipComment(const char *p, const char *end)
+{
+    const char *close = (const char *)memchr(p, '}', end - p);
+    return close ? close + 1 : end;
+}
+
+bool IsBlankLine(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p == end || *p == '\n';
+}
+
+// the first line at or after p that starts with a tag and follows a blank
+// line, which follows a line that isn't a tag. export format PGN separates
+// games this way, a tag in a comment would need a blank line before it too
+const char *FindGameStart(const char *begin, const char *p, const char *end)
+{
+    while (p > begin && p[-1] != '\n')
+        p--;
+
+    // what came before p, looking back over blank lines
+    bool blank    = p == begin;
+    bool afterTag = false;
+    for (const char *line = p; line > begin;)
+    {
+        const char *lineEnd = line - 1;
+        line                = lineEnd;
+        while (line > begin && line[-1] != '\n')
+            line--;
+        if (!IsBlankLine(line, lineEnd))
+        {
+            afterTag = *line == '[';
+            break;
+        }
+        blank = true;
+    }
+
+    for (; p < end; p = NextLine(p, end))
+    {
+        if (*p == '[' && blank && !afterTag)
+            return p;
+        blank = IsBlankLine(p, end);
+        if (!blank)
+            afterTag = *p == '[';
+    }
+    return end;
+}
+
+// a tag pair from its '[', quoted values may hold ']'
+const char *SkipTag(const char *p, const char *end)
+{
+    bool quoted = false;
+    for (p++; p < end; p++)
+    {
+        if (quoted && *p == '\\')
+            p++;
+        else if (*p == '"')
+            quoted = !quoted;
+        else if (*p == ']' && !quoted)
+            return p + 1;
+    }
+    return end;
+}
+
+bool IsResult(std::string_view token)
+{
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" ||
+           token == "*";
+}
+
+} // namespace
+
+std::vector<const char *> SplitGames(
+    const char *begin, const char *end, size_t n)
+{
+    std::vector<const char *> bounds;
+    bounds.push_back(begin);
+    for (size_t i = 1; i < n; i++)
+    {
+        const char *target = begin + (end - begin) * i / n;
+        bounds.push_back(
+            std::max(FindGameStart(begin, target, end), bounds.back()));
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+std::string_view TagValue(const Game &game, std::string_view name)
+{
+    const char *p   = game.tags.data();
+    const char *end = p + game.tags.size();
+    while ((p = (const char *)memchr(p, '[', end - p)) != nullptr)
+    {
+        const char *tagEnd = SkipTag(p, end);
+
+        const char *n = p + 1;
+        while (n < tagEnd && IsSpace(*n))
+            n++;
+        const char *nameEnd = n;
+        while (nameEnd < tagEnd && !IsSpace(*nameEnd) && *nameEnd != '"')
+            nameEnd++;
+
+        const char *value = (const char *)memchr(n, '"', tagEnd - n);
+        if (value && std::string_view(n, nameEnd - n) == name)
+        {
+            const char *valueEnd = ++value;
+            while (valueEnd < tagEnd && *valueEnd != '"')
+                valueEnd += *valueEnd == '\\' ? 2 : 1;
+            valueEnd = std::min(valueEnd, tagEnd);
+            return std::string_view(value, valueEnd - value);
+        }
+        p = tagEnd;
+    }
+    return std::string_view();
+}
+
+bool GameReader::Next(Game &game)
+{
+    while (p < end && IsSpace(*p))
+        p++;
+    if (p == end)
+        return false;
+
+    // tag pairs, then the movetext up to the next game's first tag
+    game.start = p;
+    while (p < end && *p == '[')
+    {
+        p = SkipTag(p, end);
+        while (p < end && IsSpace(*p))
+            p++;
+    }
+    game.tags = std::string_view(game.start, p - game.start);
+
+    // a tag only starts a game at the start of a line outside a comment
+    const char *movetext = p;
+    bool lineStart       = false;
+    while (p < end)
+    {
+        char c = *p;
+        if (lineStart && c == '[')
+            break;
+        if (c == '{')
+            p = SkipComment(p + 1, end);
+        else if (c == ';' || (lineStart && c == '%'))
+            p = LineEnd(p, end);
+        else
+            p++;
+        lineStart = c == '\n';
+    }
+
+    const char *movetextEnd = p;
+    while (movetextEnd > movetext && IsSpace(movetextEnd[-1]))
+        movetextEnd--;
+    game.movetext = std::string_view(movetext, movetextEnd - movetext);
+    return true;
+}
+
+bool MoveReader::Next(char san[MAX_SAN])
+{
+    int depth = 0; // variations are skipped whole
+    while (p < end)
+    {
+        char c = *p;
+        if (IsSpace(c))
+        {
+            p++;
+            continue;
+        }
+        if (c == '{')
+        {
+            p = SkipComment(p + 1, end);
+            continue;
+        }
+        if (c == ';')
+        {
+            p = NextLine(p, end);
+            continue;
+        }
+        if (c == '}') // stray, there was no comment to close
+        {
+            p++;
+            continue;
+        }
+        if (c == '(' || c == ')')
+        {
+            depth = c == '(' ? depth + 1 : std::max(depth - 1, 0);
+            p++;
+            continue;
+        }
+
+        const char *token = p;
+        while (p < end && !IsDelimiter(*p))
+            p++;
+        std::string_view move(token, p - token);
+        if (depth > 0 || c == '$')
+            continue;
+
+        if (IsResult(move))
+        {
+            result = move;
+            p      = end;
+            return false;
+        }
+
+        // a move number, perhaps run into its move as in "12.e4"
+        if (IsDigit(c))
+        {
+            size_t digits = 0;
+            while (digits < move.size() && IsDigit(move[digits]))
+                digits++;
+            size_t dots = digits;
+            while (dots < move.size() && move[dots] == '.')
+                dots++;
+            if (dots > digits)
+                move.remove_prefix(dots);
+            if (move.empty())
+                continue;
+        }
+
+        // castling is sometimes written with zeros
+        if (move.substr(0, 3) == "0-0")
+            move = move.substr(0, 5) == "0-0-0" ? "O-O-O" : "O-O";
+
+        size_t n = std::min(move.size(), MAX_SAN - 1);
+        memcpy(san, move.data(), n);
+        san[n] = '\0';
+        return true;
+    }
+    return false;
+}
+
+} // namespace Pgn
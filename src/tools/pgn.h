@@ -0,0 +1,74 @@
+#pragma once
+
+// reading PGN files without copying them
+//
+// the file is mapped into memory (thc::MappedFile) and games, tags and moves
+// are read as views into it, so reading a game allocates nothing. the
+// mapping can be split on game boundaries for several threads to read at once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace Pgn
+{
+
+// longest move token kept, "exd8=Q+!?" and the like fit easily
+const size_t MAX_SAN = 16;
+
+// cut [begin, end) into at most n pieces that each start on a game, for
+// threads to read separately. the returned pointers are the n + 1 ends of
+// the pieces, some pieces may be empty
+std::vector<const char *> SplitGames(
+    const char *begin, const char *end, size_t n);
+
+struct Game
+{
+    const char *start;         // where the game begins in the file
+    std::string_view tags;     // the tag pairs, each "[Name "value"]"
+    std::string_view movetext; // moves, comments and the result
+};
+
+// value of a tag, still escaped, empty if the game doesn't have it
+std::string_view TagValue(const Game &game, std::string_view name);
+
+// games one after another from PGN text
+class GameReader
+{
+  public:
+    GameReader(const char *begin, const char *end) : p(begin), end(end) {}
+
+    // false once there are no more games
+    bool Next(Game &game);
+
+  private:
+    const char *p;
+    const char *end;
+};
+
+// the moves of a game's movetext, in order
+//
+// move numbers, comments, NAGs and variations are skipped, reading stops at
+// the result
+class MoveReader
+{
+  public:
+    explicit MoveReader(std::string_view movetext)
+        : p(movetext.data()), end(movetext.data() + movetext.size())
+    {
+    }
+
+    // copy the next move to san, false after the last one
+    // longer tokens are cut to MAX_SAN - 1 characters, which won't parse
+    bool Next(char san[MAX_SAN]);
+
+    // "1-0", "0-1", "1/2-1/2" or "*" once reached, otherwise empty
+    std::string_view Result() const { return result; }
+
+  private:
+    const char *p;
+    const char *end;
+    std::string_view result;
+};
+
+} // namespace Pgn
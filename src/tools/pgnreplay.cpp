@@ -0,0 +1,368 @@
+// replays every game of a PGN file or a binary game archive through the
+// rules engine
+//
+// the file is memory mapped and cut into pieces on game boundaries, worker
+// threads take a piece at a time and replay its games move by move on a
+// thc::ChessRules. PGN moves are read straight out of the mapping, so
+// nothing is allocated a move, archive moves are found by their index among
+// the legal moves. reports games, moves and megabytes per second and the
+// results, a benchmark for SAN parsing, a check that a corpus is legal and a
+// comparison of the two formats on the same games
+//
+// usage:
+//   pgnreplay.out [options] <file>
+//     --threads <n>    default one per hardware thread
+//     --fast           parse PGN moves with SanIn() trusting them to be
+//                      legal, for input from a program rather than a person
+//     --archive <file> also write a PGN file's games to a binary archive, in
+//                      the order threads finish them. games set up from a
+//                      FEN are left out
+
+#include "../thc/archive.h"
+#include "../thc/mapped.h"
+#include "../thc/thc.h"
+#include "pgn.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// pieces a thread, so a thread with slow games doesn't finish last by much
+const size_t PIECES_PER_THREAD = 16;
+const size_t MIN_PIECE_BYTES   = 64 * 1024;
+
+// only the first few bad games are described
+const int MAX_REPORTED_ERRORS = 10;
+
+struct Options
+{
+    int threads             = 0;
+    bool fast               = false;
+    const char *path        = nullptr;
+    const char *archivePath = nullptr;
+};
+
+struct Totals
+{
+    std::atomic<uint64_t> games{0};
+    std::atomic<uint64_t> moves{0};
+    std::atomic<uint64_t> badGames{0};
+    std::atomic<uint64_t> unarchived{0};
+    std::atomic<uint64_t> results[4] = {{0}, {0}, {0}, {0}};
+};
+
+// a piece's games, added to the totals once it is done
+struct Counts
+{
+    uint64_t games      = 0;
+    uint64_t moves      = 0;
+    uint64_t badGames   = 0;
+    uint64_t results[4] = {};
+
+    // plies is -1 for a game that couldn't be replayed
+    void Game(int plies, thc::ArchiveResult result)
+    {
+        games++;
+        if (plies < 0)
+            badGames++;
+        else
+            moves += plies;
+        if (result < 4)
+            results[result]++;
+    }
+
+    void AddTo(Totals &totals) const
+    {
+        totals.games.fetch_add(games, std::memory_order_relaxed);
+        totals.moves.fetch_add(moves, std::memory_order_relaxed);
+        totals.badGames.fetch_add(badGames, std::memory_order_relaxed);
+        for (int r = 0; r < 4; r++)
+            totals.results[r].fetch_add(results[r], std::memory_order_relaxed);
+    }
+};
+
+thc::ArchiveResult ResultOf(std::string_view result)
+{
+    return result == "1-0"       ? thc::ARCHIVE_WHITE_WINS
+           : result == "0-1"     ? thc::ARCHIVE_BLACK_WINS
+           : result == "1/2-1/2" ? thc::ARCHIVE_DRAW
+                                 : thc::ARCHIVE_UNFINISHED;
+}
+
+class ErrorLog
+{
+  public:
+    // report a game that couldn't be replayed, offset is its byte in the file
+    void Report(size_t offset, const char *what, const char *move)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (reported++ < MAX_REPORTED_ERRORS)
+            fprintf(stderr, "game at byte %zu: %s %s\n", offset, what, move);
+    }
+
+  private:
+    std::mutex lock;
+    int reported = 0;
+};
+
+// games written to the archive, from all the threads
+class ArchiveOutput
+{
+  public:
+    bool Open(const char *path) { return writer.Open(path); }
+    bool Close() { return writer.Close(); }
+
+    bool Write(const std::vector<uint8_t> &moves, thc::ArchiveResult result)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return writer.Write(moves.data(), moves.size(), result);
+    }
+
+  private:
+    std::mutex lock;
+    thc::ArchiveWriter writer;
+};
+
+// replay one game, the number of moves played or -1 if one was illegal, and
+// its result. with archive set the game is written to it too, if it can be
+int ReplayGame(
+    const Pgn::Game &game, const char *fileStart, bool fast, ErrorLog &errors,
+    ArchiveOutput *archive, Totals &totals, thc::ArchiveResult &result)
+{
+    thc::ChessRules position;
+    Pgn::MoveReader reader(game.movetext);
+    result = thc::ARCHIVE_UNFINISHED;
+    std::string_view fen = Pgn::TagValue(game, "FEN");
+    if (!fen.empty())
+    {
+        char buffer[128];
+        size_t n = std::min(fen.size(), sizeof(buffer) - 1);
+        memcpy(buffer, fen.data(), n);
+        buffer[n] = '\0';
+        if (!position.Forsyth(buffer))
+        {
+            errors.Report(game.start - fileStart, "bad FEN", buffer);
+            return -1;
+        }
+    }
+
+    char san[Pgn::MAX_SAN];
+    int plies = 0;
+
+    // archived games start from the standard position
+    bool record = archive != nullptr && fen.empty();
+    thread_local std::vector<uint8_t> indices;
+    indices.clear();
+    while (reader.Next(san))
+    {
+        thc::Move move;
+        bool ok = fast ? move.SanIn(&position, san, true)
+                       : move.NaturalIn(&position, san);
+        if (!ok)
+        {
+            errors.Report(game.start - fileStart, "illegal move", san);
+            return -1;
+        }
+        if (record)
+        {
+            thc::MOVELIST legal;
+            position.GenLegalMoveList(&legal);
+            indices.push_back((uint8_t)thc::ArchiveMoveIndex(legal, move));
+        }
+        position.PlayMove(move);
+        plies++;
+    }
+
+    result = ResultOf(reader.Result());
+    if (archive && !(record && archive->Write(indices, result)))
+        totals.unarchived.fetch_add(1, std::memory_order_relaxed);
+    return plies;
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--fast") == 0)
+            options.fast = true;
+        else if (strcmp(arg, "--threads") == 0 && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(arg, "--archive") == 0 && i + 1 < argc)
+            options.archivePath = argv[++i];
+        else if (arg[0] != '-' && options.path == nullptr)
+            options.path = arg;
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+    }
+    if (options.path == nullptr)
+    {
+        fprintf(stderr, "usage: pgnreplay.out [options] <file>\n");
+        return false;
+    }
+    if (options.threads <= 0)
+    {
+        unsigned n      = std::thread::hardware_concurrency();
+        options.threads = n ? (int)n : 1;
+    }
+    return true;
+}
+
+// replay pieces 0 to n - 1 on the threads, each thread taking the next piece
+// left until there are none
+template <typename ReplayPiece>
+void RunThreads(int threads, size_t n, ReplayPiece replayPiece)
+{
+    std::atomic<size_t> nextPiece(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&] {
+            size_t piece;
+            while ((piece = nextPiece.fetch_add(1)) < n)
+                replayPiece(piece);
+        });
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 1;
+
+    thc::MappedFile file;
+    if (!file.Open(options.path))
+    {
+        fprintf(stderr, "can't open %s\n", options.path);
+        return 1;
+    }
+
+    // an archive is known by its header, anything else is read as PGN
+    thc::ArchiveReader source;
+    bool fromArchive = source.Open(file.Begin(), file.Size());
+
+    ArchiveOutput archiveOutput;
+    ArchiveOutput *archive = nullptr;
+    if (options.archivePath)
+    {
+        if (fromArchive)
+        {
+            fprintf(stderr, "%s is already an archive\n", options.path);
+            return 1;
+        }
+        if (!archiveOutput.Open(options.archivePath))
+        {
+            fprintf(stderr, "can't create %s\n", options.archivePath);
+            return 1;
+        }
+        archive = &archiveOutput;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t pieces = std::min(
+        options.threads * PIECES_PER_THREAD, file.Size() / MIN_PIECE_BYTES);
+    pieces = std::max<size_t>(pieces, 1);
+    Totals totals;
+    ErrorLog errors;
+
+    if (fromArchive)
+    {
+        std::vector<const uint8_t *> bounds = source.Split(pieces);
+        RunThreads(options.threads, bounds.size() - 1, [&](size_t piece) {
+            Counts counts;
+            thc::ChessRules position;
+            const uint8_t *p = bounds[piece];
+            thc::ArchiveGame game;
+            while (thc::ArchiveReader::Next(p, bounds[piece + 1], game))
+            {
+                bool ok = thc::ArchiveReader::Replay(game, position);
+                counts.Game(ok ? (int)game.plies : -1, game.result);
+            }
+            counts.AddTo(totals);
+        });
+    }
+    else
+    {
+        std::vector<const char *> bounds =
+            Pgn::SplitGames(file.Begin(), file.End(), pieces);
+        RunThreads(options.threads, bounds.size() - 1, [&](size_t piece) {
+            Counts counts;
+            Pgn::GameReader reader(bounds[piece], bounds[piece + 1]);
+            Pgn::Game game;
+            while (reader.Next(game))
+            {
+                thc::ArchiveResult result;
+                int plies = ReplayGame(
+                    game, file.Begin(), options.fast, errors, archive, totals,
+                    result);
+                counts.Game(plies, result);
+            }
+            counts.AddTo(totals);
+        });
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count();
+    double games   = (double)totals.games.load();
+    double moves   = (double)totals.moves.load();
+    double mb      = file.Size() / (1024.0 * 1024.0);
+
+    bool archived = archive == nullptr || archiveOutput.Close();
+    if (!archived)
+        fprintf(stderr, "writing %s failed\n", options.archivePath);
+
+    printf(
+        "%llu games, %llu moves, %.1f MB on %d threads in %.3fs\n"
+        "%.1f games/s %.0f moves/s %.1f MB/s %.2f bytes/move\n"
+        "1-0 %llu, 0-1 %llu, 1/2-1/2 %llu, * %llu\n"
+        "%llu games with illegal moves\n",
+        (unsigned long long)totals.games.load(),
+        (unsigned long long)totals.moves.load(),
+        mb,
+        options.threads,
+        seconds,
+        seconds > 0 ? games / seconds : 0,
+        seconds > 0 ? moves / seconds : 0,
+        seconds > 0 ? mb / seconds : 0,
+        moves > 0 ? file.Size() / moves : 0,
+        (unsigned long long)totals.results[thc::ARCHIVE_WHITE_WINS].load(),
+        (unsigned long long)totals.results[thc::ARCHIVE_BLACK_WINS].load(),
+        (unsigned long long)totals.results[thc::ARCHIVE_DRAW].load(),
+        (unsigned long long)totals.results[thc::ARCHIVE_UNFINISHED].load(),
+        (unsigned long long)totals.badGames.load());
+
+    // a count that doesn't match means the archive was cut short or not
+    // closed
+    if (fromArchive && source.Games() != totals.games.load())
+        printf("header says %llu games\n", (unsigned long long)source.Games());
+    if (archive)
+    {
+        uint64_t written = totals.games.load() - totals.badGames.load() -
+                           totals.unarchived.load();
+        printf(
+            "%llu games archived, %llu left out\n",
+            (unsigned long long)written,
+            (unsigned long long)totals.unarchived.load());
+    }
+    if (!archived)
+        return 1;
+    return totals.badGames.load() ? 2 : 0;
+}
@@ -0,0 +1,235 @@
+// builds a position index from a game archive, and looks positions up in it
+//
+// every position of every game in the archive is indexed with the game's
+// result, each game known by its offset in the archive. the builder holds
+// --memory megabytes of positions at a time and sorts the rest on temporary
+// files in $TMPDIR, so archives of any size can be indexed. looking up
+// prints a position's results and the first of its games
+//
+// usage:
+//   posindex.out [options] <archive> <index>
+//     --memory <mb>    positions held before sorting to disk, default 256
+//     --plies <n>      only index the first n plies of each game
+//   posindex.out --find <fen> <index> [<archive>]
+
+#include "../thc/archive.h"
+#include "../thc/mapped.h"
+#include "../thc/posindex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+// only the first few games of a position are listed
+const uint32_t MAX_LISTED_GAMES = 10;
+
+struct Options
+{
+    size_t memoryMb      = 256;
+    size_t plies         = thc::ARCHIVE_MAX_PLIES;
+    const char *fen      = nullptr;
+    const char *paths[3] = {nullptr, nullptr, nullptr};
+    int pathCount        = 0;
+};
+
+double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--memory") == 0 && i + 1 < argc)
+            options.memoryMb = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--plies") == 0 && i + 1 < argc)
+            options.plies = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--find") == 0 && i + 1 < argc)
+            options.fen = argv[++i];
+        else if (arg[0] != '-' && options.pathCount < 3)
+            options.paths[options.pathCount++] = arg;
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+    }
+
+    bool ok = options.fen ? options.pathCount >= 1 : options.pathCount == 2;
+    if (!ok)
+    {
+        fprintf(stderr,
+            "usage: posindex.out [options] <archive> <index>\n"
+            "       posindex.out --find <fen> <index> [<archive>]\n");
+    }
+    return ok;
+}
+
+int Build(const Options &options)
+{
+    thc::MappedFile file;
+    thc::ArchiveReader archive;
+    if (!file.Open(options.paths[0]) ||
+        !archive.Open(file.Begin(), file.Size()))
+    {
+        fprintf(stderr, "can't read archive %s\n", options.paths[0]);
+        return 1;
+    }
+    thc::PositionIndexBuilder builder;
+    if (!builder.Open(options.paths[1], options.memoryMb * 1024 * 1024))
+    {
+        fprintf(stderr, "can't create %s\n", options.paths[1]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // every position from the start up to the last move or ply limit
+    std::vector<const uint8_t *> bounds = archive.Split(1);
+    const uint8_t *begin                = (const uint8_t *)file.Begin();
+    const uint8_t *p                    = bounds[0];
+
+    uint64_t games = 0, added = 0, badGames = 0;
+    thc::ArchiveGame game;
+    thc::ChessRules position;
+    thc::MOVELIST legal;
+    thc::CompressedPosition key;
+    bool ok = true;
+    while (ok)
+    {
+        uint64_t id = p - begin;
+        if (!thc::ArchiveReader::Next(p, bounds[1], game))
+            break;
+        games++;
+
+        position     = thc::ChessRules();
+        size_t plies = std::min(game.plies, options.plies);
+        for (size_t i = 0; ok; i++)
+        {
+            position.Compress(key);
+            ok = builder.Add(key, id, game.result);
+            added++;
+            if (i == plies)
+                break;
+
+            thc::Move move;
+            position.GenLegalMoveList(&legal);
+            if (!thc::ArchiveMoveAt(legal, game.moves[i], move))
+            {
+                badGames++;
+                break;
+            }
+            position.PlayMove(move);
+        }
+    }
+    double replayed = SecondsSince(start);
+
+    ok = builder.Close() && ok;
+    if (!ok)
+    {
+        fprintf(stderr, "writing %s failed\n", options.paths[1]);
+        return 1;
+    }
+    double seconds = SecondsSince(start);
+
+    printf(
+        "%llu games, %llu positions, %llu distinct in %.3fs\n"
+        "replaying %.3fs, sorting and writing %.3fs, %.0f positions/s\n"
+        "%llu games with bad moves\n",
+        (unsigned long long)games,
+        (unsigned long long)added,
+        (unsigned long long)builder.Positions(),
+        seconds,
+        replayed,
+        seconds - replayed,
+        seconds > 0 ? added / seconds : 0,
+        (unsigned long long)badGames);
+    return badGames ? 2 : 0;
+}
+
+int Find(const Options &options)
+{
+    thc::ChessRules position;
+    if (!position.Forsyth(options.fen))
+    {
+        fprintf(stderr, "bad FEN %s\n", options.fen);
+        return 1;
+    }
+    thc::PositionIndex index;
+    if (!index.Open(options.paths[0]))
+    {
+        fprintf(stderr, "can't read index %s\n", options.paths[0]);
+        return 1;
+    }
+
+    // with the archive the games can be shown, not just their offsets
+    thc::MappedFile file;
+    thc::ArchiveReader archive;
+    bool haveArchive = options.paths[1] &&
+                       file.Open(options.paths[1], thc::MAPPED_RANDOM) &&
+                       archive.Open(file.Begin(), file.Size());
+
+    auto start = std::chrono::steady_clock::now();
+    thc::PositionStats stats;
+    uint64_t first;
+    bool found    = index.Find(position, stats, first);
+    double micros = SecondsSince(start) * 1e6;
+
+    if (!found)
+    {
+        printf("no games, %.1fus\n", micros);
+        return 0;
+    }
+    printf("%u games, 1-0 %u, 0-1 %u, 1/2-1/2 %u, %.1fus\n", stats.games,
+        stats.whiteWins, stats.blackWins, stats.draws, micros);
+    for (uint32_t i = 0; i < stats.games && i < MAX_LISTED_GAMES; i++)
+    {
+        uint64_t id = index.Game(first, i);
+        thc::ArchiveGame game;
+        if (haveArchive && archive.GameAt(id, game))
+        {
+            // the game in SAN, read back from its archive indices
+            thc::ChessRules replay;
+            thc::MOVELIST legal;
+            std::string moves;
+            for (size_t ply = 0; ply < game.plies; ply++)
+            {
+                thc::Move move;
+                replay.GenLegalMoveList(&legal);
+                if (!thc::ArchiveMoveAt(legal, game.moves[ply], move))
+                    break;
+                char san[MAXNATURAL];
+                move.NaturalOut(&replay, san);
+                if (ply % 2 == 0)
+                    moves += std::to_string(ply / 2 + 1) + ".";
+                moves += san;
+                moves += ' ';
+                replay.PlayMove(move);
+            }
+            printf("game at %llu: %s\n", (unsigned long long)id,
+                moves.c_str());
+        }
+        else
+            printf("game at %llu\n", (unsigned long long)id);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 1;
+    return options.fen ? Find(options) : Build(options);
+}
@@ -0,0 +1,279 @@
+// plays many games of the rules engine against itself
+//
+// each worker thread plays whole games on its own thc::ChessEvaluation,
+// choosing from GenLegalMoveListSorted() with some randomness so the games
+// differ. games are written as PGN, and the run reports games and moves per
+// second, a whole game workload for the rules engine rather than perft's
+//
+// usage:
+//   selfplay.out [options]
+//     --games <n>          games to play, default 1000
+//     --threads <n>        default one per hardware thread
+//     --randomness <r>     0 always plays the best sorted move, towards 1
+//                          plays further down the list, default 0.5
+//     --seed <n>           games are repeatable for a given seed
+//     --max-plies <n>      unfinished games are stopped here, default 500
+//     --pgn <file>         where to write the games, none if not given
+
+#include "../thc/thc.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct Options
+{
+    uint64_t games    = 1000;
+    int threads       = 0;
+    double randomness = 0.5;
+    uint64_t seed     = 1;
+    int maxPlies      = 500;
+    const char *pgn   = nullptr;
+};
+
+enum Outcome
+{
+    OUTCOME_WHITE_WINS,
+    OUTCOME_BLACK_WINS,
+    OUTCOME_DRAW,
+    OUTCOME_UNFINISHED,
+    OUTCOME_COUNT,
+};
+
+const char *const RESULT_STR[OUTCOME_COUNT] = {"1-0", "0-1", "1/2-1/2", "*"};
+
+struct GameRecord
+{
+    Outcome outcome;
+    const char *termination;
+    int plies;
+    std::string moves; // movetext, empty if no PGN is written
+};
+
+// moves are taken down the sorted list, each with probability 1 - r of
+// stopping there, so better moves are always more likely
+int PickMove(int count, double randomness, std::mt19937_64 &rng)
+{
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    int i = 0;
+    while (i + 1 < count && uniform(rng) < randomness)
+        i++;
+    return i;
+}
+
+GameRecord PlayGame(const Options &options, uint64_t gameIndex)
+{
+    std::mt19937_64 rng(options.seed * 0x9e3779b97f4a7c15ull + gameIndex);
+
+    GameRecord record = {OUTCOME_UNFINISHED, "max plies", 0, std::string()};
+    thc::ChessEvaluation position;
+    thc::MOVELIST list;
+
+    while (record.plies < options.maxPlies)
+    {
+        position.GenLegalMoveListSorted(&list);
+        if (list.count == 0)
+        {
+            thc::TERMINAL terminal;
+            position.Evaluate(terminal);
+            if (terminal == thc::TERMINAL_WCHECKMATE)
+                record.outcome = OUTCOME_BLACK_WINS;
+            else if (terminal == thc::TERMINAL_BCHECKMATE)
+                record.outcome = OUTCOME_WHITE_WINS;
+            else
+                record.outcome = OUTCOME_DRAW;
+            record.termination = record.outcome == OUTCOME_DRAW
+                                     ? "stalemate"
+                                     : "checkmate";
+            return record;
+        }
+
+        thc::DRAWTYPE draw;
+        if (position.IsDraw(true, draw))
+        {
+            record.outcome     = OUTCOME_DRAW;
+            record.termination = draw == thc::DRAWTYPE_50MOVE ? "50 move rule"
+                                 : draw == thc::DRAWTYPE_REPITITION
+                                     ? "repetition"
+                                     : "insufficient material";
+            return record;
+        }
+
+        int pick       = PickMove(list.count, options.randomness, rng);
+        thc::Move move = list.moves[pick];
+        if (options.pgn)
+        {
+            if (position.WhiteToPlay())
+                record.moves += std::to_string(record.plies / 2 + 1) + ". ";
+            char san[MAXNATURAL];
+            move.NaturalOut(&position, san);
+            record.moves += san;
+            record.moves += ' ';
+        }
+        position.PlayMove(move);
+        record.plies++;
+    }
+    return record;
+}
+
+// PGN keeps lines under 80 characters, breaking movetext between moves
+std::string WrapMovetext(const std::string &text)
+{
+    std::string wrapped;
+    size_t lineStart = 0;
+    size_t word      = 0;
+    while (word < text.size())
+    {
+        size_t end = text.find(' ', word);
+        if (end == std::string::npos)
+            end = text.size();
+        if (end - lineStart > 79 && word > lineStart)
+        {
+            wrapped.back() = '\n';
+            lineStart      = word;
+        }
+        wrapped.append(text, word, end - word);
+        wrapped += ' ';
+        word = end + 1;
+    }
+    return wrapped;
+}
+
+void WritePgn(FILE *file, uint64_t round, const GameRecord &record)
+{
+    std::string movetext =
+        WrapMovetext(record.moves + RESULT_STR[record.outcome]);
+    fprintf(
+        file,
+        "[Event \"selfplay\"]\n"
+        "[Site \"?\"]\n"
+        "[Date \"????.??.??\"]\n"
+        "[Round \"%llu\"]\n"
+        "[White \"chess_2\"]\n"
+        "[Black \"chess_2\"]\n"
+        "[Result \"%s\"]\n"
+        "[Termination \"%s\"]\n"
+        "[PlyCount \"%d\"]\n\n%s\n\n",
+        (unsigned long long)round,
+        RESULT_STR[record.outcome],
+        record.termination,
+        record.plies,
+        movetext.c_str());
+}
+
+bool ParseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg   = argv[i];
+        const char *value = i + 1 < argc ? argv[++i] : nullptr;
+        if (value == nullptr)
+        {
+            fprintf(stderr, "%s needs a value\n", arg);
+            return false;
+        }
+
+        if (strcmp(arg, "--games") == 0)
+            options.games = strtoull(value, nullptr, 10);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = atoi(value);
+        else if (strcmp(arg, "--randomness") == 0)
+            options.randomness = atof(value);
+        else if (strcmp(arg, "--seed") == 0)
+            options.seed = strtoull(value, nullptr, 10);
+        else if (strcmp(arg, "--max-plies") == 0)
+            options.maxPlies = atoi(value);
+        else if (strcmp(arg, "--pgn") == 0)
+            options.pgn = value;
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+    }
+    if (options.threads <= 0)
+    {
+        unsigned n      = std::thread::hardware_concurrency();
+        options.threads = n ? (int)n : 1;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return 1;
+
+    FILE *pgn = nullptr;
+    if (options.pgn && (pgn = fopen(options.pgn, "w")) == nullptr)
+    {
+        fprintf(stderr, "can't open %s\n", options.pgn);
+        return 1;
+    }
+
+    // games are handed out one at a time, so slow games don't hold up a
+    // thread's share of the rest
+    std::atomic<uint64_t> nextGame(0);
+    std::atomic<uint64_t> totalPlies(0);
+    std::atomic<uint64_t> outcomes[OUTCOME_COUNT] = {};
+    std::mutex pgnLock;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; t++)
+    {
+        workers.emplace_back([&] {
+            uint64_t game;
+            while ((game = nextGame.fetch_add(1)) < options.games)
+            {
+                GameRecord record = PlayGame(options, game);
+                totalPlies.fetch_add(record.plies, std::memory_order_relaxed);
+                outcomes[record.outcome].fetch_add(
+                    1, std::memory_order_relaxed);
+                if (pgn)
+                {
+                    std::lock_guard<std::mutex> lock(pgnLock);
+                    WritePgn(pgn, game + 1, record);
+                }
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count();
+
+    if (pgn)
+        fclose(pgn);
+
+    printf(
+        "%llu games, %llu moves on %d threads in %.3fs\n"
+        "%.1f games/s %.0f moves/s\n"
+        "white %llu black %llu draw %llu unfinished %llu\n",
+        (unsigned long long)options.games,
+        (unsigned long long)totalPlies.load(),
+        options.threads,
+        seconds,
+        seconds > 0 ? options.games / seconds : 0,
+        seconds > 0 ? totalPlies.load() / seconds : 0,
+        (unsigned long long)outcomes[OUTCOME_WHITE_WINS].load(),
+        (unsigned long long)outcomes[OUTCOME_BLACK_WINS].load(),
+        (unsigned long long)outcomes[OUTCOME_DRAW].load(),
+        (unsigned long long)outcomes[OUTCOME_UNFINISHED].load());
+    return 0;
+}
@@ -0,0 +1,314 @@
+// UCI front end for the engine, so it can play in tournament managers
+//
+// the search runs on its own thread while this one keeps reading commands,
+// so stop, isready and quit are answered straight away. supports
+//   uci, isready, ucinewgame, quit
+//   setoption name Hash|Threads value <n>
+//   position startpos|fen <fen> [moves <move>...]
+//   go [depth <n>] [nodes <n>] [movetime <ms>] [infinite]
+//      [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>]
+//   stop
+
+#include "../engine/smp.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+const int DEFAULT_HASH_MB = 16;
+const int MAX_HASH_MB     = 4096;
+const int MAX_THREADS     = 256;
+
+// clock times are a best guess at how many moves are left
+const int MOVES_TO_GO_GUESS = 30;
+const int MOVE_OVERHEAD_MS  = 30; // for the time lost talking to the gui
+
+class UciEngine
+{
+  public:
+    UciEngine();
+
+    // stops any search and waits for it
+    ~UciEngine();
+
+    // answer commands from stdin until quit or end of input
+    void Loop();
+
+  private:
+    void Uci();
+    void SetOption(std::istringstream &in);
+    void Position(std::istringstream &in);
+    void Go(std::istringstream &in);
+
+    // stop a running search and wait for its bestmove
+    void StopSearch();
+
+    void Send(const std::string &line);
+    void SendInfo(const Engine::SearchResult &result, uint64_t nodes);
+
+    thc::ChessRules position;
+    Engine::TranspositionTable tt;
+    int threads;
+
+    std::thread searcher;
+    std::atomic<bool> stop;
+    std::chrono::steady_clock::time_point searchStart;
+    std::mutex output; // info lines come from the search thread
+};
+
+// the engine's scores are 40 to a pawn
+std::string ScoreStr(int score)
+{
+    if (!Engine::IsMateScore(score))
+        return "cp " + std::to_string(score * 5 / 2);
+
+    int plies = Engine::SCORE_MATE - (score > 0 ? score : -score);
+    int moves = (plies + 1) / 2;
+    return "mate " + std::to_string(score > 0 ? moves : -moves);
+}
+
+UciEngine::UciEngine() : tt(DEFAULT_HASH_MB), threads(1), stop(false) {}
+
+UciEngine::~UciEngine() { StopSearch(); }
+
+void UciEngine::Loop()
+{
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+
+        if (command == "uci")
+            Uci();
+        else if (command == "isready")
+            Send("readyok");
+        else if (command == "ucinewgame")
+        {
+            StopSearch();
+            tt.Clear();
+            position = thc::ChessRules();
+        }
+        else if (command == "setoption")
+            SetOption(in);
+        else if (command == "position")
+            Position(in);
+        else if (command == "go")
+            Go(in);
+        else if (command == "stop")
+            StopSearch();
+        else if (command == "quit")
+            break;
+    }
+}
+
+void UciEngine::Uci()
+{
+    Send("id name chess_2");
+    Send("id author chess_2 developers");
+    Send(
+        "option name Hash type spin default " +
+        std::to_string(DEFAULT_HASH_MB) + " min 1 max " +
+        std::to_string(MAX_HASH_MB));
+    Send(
+        "option name Threads type spin default 1 min 1 max " +
+        std::to_string(MAX_THREADS));
+    Send("uciok");
+}
+
+void UciEngine::SetOption(std::istringstream &in)
+{
+    std::string token, name, value;
+    in >> token; // name
+    in >> name;
+    in >> token; // value
+    in >> value;
+
+    int n = 0;
+    try
+    {
+        n = std::stoi(value);
+    }
+    catch (const std::exception &)
+    {
+        return;
+    }
+
+    // neither can change under a running search
+    StopSearch();
+    if (name == "Hash")
+        tt.Resize(std::max(1, std::min(n, MAX_HASH_MB)));
+    else if (name == "Threads")
+        threads = std::max(1, std::min(n, MAX_THREADS));
+}
+
+void UciEngine::Position(std::istringstream &in)
+{
+    StopSearch();
+
+    std::string token;
+    in >> token;
+    // ChessRules::Init() only clears the move history, a new ChessRules is
+    // the standard position
+    if (token == "startpos")
+    {
+        position = thc::ChessRules();
+        in >> token; // moves, if any
+    }
+    else if (token == "fen")
+    {
+        std::string fen;
+        while (in >> token && token != "moves")
+            fen += token + " ";
+        if (!position.Forsyth(fen.c_str()))
+        {
+            Send("info string invalid fen " + fen);
+            position = thc::ChessRules();
+            return;
+        }
+    }
+    else
+        return;
+
+    // played rather than set up, so repetitions of earlier positions count
+    while (in >> token)
+    {
+        thc::Move move;
+        if (!move.TerseIn(&position, token.c_str()))
+        {
+            Send("info string illegal move " + token);
+            return;
+        }
+        position.PlayMove(move);
+    }
+}
+
+void UciEngine::Go(std::istringstream &in)
+{
+    StopSearch();
+
+    Engine::SearchLimits limits;
+    bool infinite = false;
+    int64_t time[2] = {0, 0}, inc[2] = {0, 0}; // white, black
+    int movesToGo   = 0;
+
+    std::string token;
+    while (in >> token)
+    {
+        int64_t value = 0;
+        if (token == "infinite")
+        {
+            infinite = true;
+            continue;
+        }
+        if (!(in >> value))
+            break;
+
+        if (token == "depth")
+            limits.depth = (int)value;
+        else if (token == "nodes")
+            limits.nodes = value;
+        else if (token == "movetime")
+            limits.timeMs = (uint32_t)value;
+        else if (token == "wtime")
+            time[0] = value;
+        else if (token == "btime")
+            time[1] = value;
+        else if (token == "winc")
+            inc[0] = value;
+        else if (token == "binc")
+            inc[1] = value;
+        else if (token == "movestogo")
+            movesToGo = (int)value;
+    }
+
+    // an even share of the clock, never more than half of what is left
+    int side = position.WhiteToPlay() ? 0 : 1;
+    if (!infinite && !limits.timeMs && time[side] > 0)
+    {
+        int64_t left  = time[side] - MOVE_OVERHEAD_MS;
+        int64_t share = left / (movesToGo ? movesToGo : MOVES_TO_GO_GUESS) +
+                        inc[side] * 3 / 4;
+        share = std::min(share, left / 2);
+        limits.timeMs = (uint32_t)std::max<int64_t>(share, 1);
+    }
+
+    stop.store(false, std::memory_order_relaxed);
+    searchStart = std::chrono::steady_clock::now();
+    tt.NewSearch();
+
+    // the search copies the position, later position commands don't touch it
+    thc::ChessRules root = position;
+    searcher = std::thread([this, root, limits, infinite] {
+        Engine::ParallelSearch search(root, &tt, threads);
+        search.OnIteration([this, &search](const Engine::SearchResult &r) {
+            SendInfo(r, search.Nodes());
+        });
+        Engine::SearchResult result = search.Run(limits, &stop);
+
+        // go infinite only answers once it is told to stop
+        while (infinite && !stop.load(std::memory_order_relaxed))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // every finished iteration has had its info line already, an
+        // unfinished one changes nothing but the node count
+        thc::Move best = result.best;
+        Send("bestmove " + (best.Valid() ? best.TerseOut() : "0000"));
+    });
+}
+
+void UciEngine::StopSearch()
+{
+    stop.store(true, std::memory_order_relaxed);
+    if (searcher.joinable())
+        searcher.join();
+}
+
+void UciEngine::Send(const std::string &line)
+{
+    std::lock_guard<std::mutex> lock(output);
+    std::cout << line << std::endl;
+}
+
+void UciEngine::SendInfo(const Engine::SearchResult &result, uint64_t nodes)
+{
+    if (result.depth == 0)
+        return;
+
+    auto elapsed = std::chrono::steady_clock::now() - searchStart;
+    int64_t ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+
+    std::ostringstream info;
+    info << "info depth " << result.depth << " score "
+         << ScoreStr(result.score) << " nodes " << nodes << " nps "
+         << nodes * 1000 / (ms ? ms : 1) << " time " << ms
+         << " hashfull " << tt.Hashfull() << " pv";
+    for (int i = 0; i < result.pvLength; i++)
+    {
+        thc::Move m = result.pv[i];
+        info << " " << m.TerseOut();
+    }
+    Send(info.str());
+}
+
+} // namespace
+
+int main()
+{
+    // Send() flushes every line, stdio's buffering isn't needed
+    std::ios::sync_with_stdio(false);
+
+    UciEngine engine;
+    engine.Loop();
+    return 0;
+}